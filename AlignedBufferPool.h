@@ -0,0 +1,94 @@
+#ifndef ALIGNEDBUFFERPOOL_H
+#define ALIGNEDBUFFERPOOL_H
+
+#include <boost/thread/mutex.hpp>
+#include <new>
+#include <stdlib.h>
+#include <vector>
+
+/**
+ * The AlignedBufferPool class is a thread-safe pool of equally sized, aligned buffers, suitable for O_DIRECT reads.
+ * Buffers are allocated on demand and kept for reuse until the pool is destroyed
+ */
+class AlignedBufferPool
+{
+public:
+
+	/**
+	 * AlignedBufferPool constructor
+	 *
+	 * @param bufferSize	The size of each buffer, a multiple of alignment
+	 * @param alignment		The alignment of each buffer, a power of two
+	 */
+	AlignedBufferPool(const size_t &bufferSize, const size_t &alignment)
+		: mBufferSize(bufferSize),
+		  mAlignment(alignment)
+	{ }
+
+	/**
+	 * AlignedBufferPool destructor.  All buffers must have been released
+	 */
+	~AlignedBufferPool()
+	{
+		for (char *buffer : mFreeBuffers)
+			free(buffer);
+	}
+
+	/**
+	 * Take a buffer from the pool, allocating a new one if the pool is empty
+	 *
+	 * @return	The buffer
+	 */
+	char* Acquire()
+	{
+		{
+			boost::mutex::scoped_lock lock(mMutex);
+			if (!mFreeBuffers.empty())
+			{
+				char *buffer = mFreeBuffers.back();
+				mFreeBuffers.pop_back();
+				return buffer;
+			}
+		}
+
+		void *buffer = NULL;
+		if (posix_memalign(&buffer, mAlignment, mBufferSize) != 0)
+			throw std::bad_alloc();
+		return static_cast<char*>(buffer);
+	}
+
+	/**
+	 * Return a buffer to the pool
+	 *
+	 * @param buffer	A buffer from Acquire
+	 */
+	void Release(char *buffer)
+	{
+		boost::mutex::scoped_lock lock(mMutex);
+		mFreeBuffers.push_back(buffer);
+	}
+
+	/**
+	 * Get the size of the buffers in this pool
+	 *
+	 * @return	The size of each buffer in bytes
+	 */
+	size_t GetBufferSize() const
+	{
+		return mBufferSize;
+	}
+
+
+private:
+	size_t mBufferSize;
+	size_t mAlignment;
+	std::vector<char*> mFreeBuffers;
+	boost::mutex mMutex;
+
+	// No copying
+	AlignedBufferPool(const AlignedBufferPool&);
+	AlignedBufferPool& operator=(const AlignedBufferPool& other);
+
+};
+
+#endif // ALIGNEDBUFFERPOOL_H
@@ -0,0 +1,221 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <fcntl.h>
+#include <new>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include "WordAccumulator.h"
+
+/**
+ * Everything needed to continue an interrupted crawl: the words counted so far, which files they came from, and which
+ * found files were still waiting to be processed
+ */
+struct Checkpoint
+{
+	Checkpoint()
+		: searchComplete(false),
+		  filesProcessed(0),
+		  bytesRead(0),
+		  bytesSkipped(0)
+	{ }
+
+	std::string options;					// The options that decide what is counted, which a resume has to match
+	bool searchComplete;					// All files have been found, so pendingFiles is the complete list of work left
+	std::vector<WordCountType> words;		// Word counts from the completed files
+	std::vector<std::string> completedFiles;
+	std::vector<std::string> pendingFiles;	// Files that were found but not completed
+	uint64_t filesProcessed;
+	uint64_t bytesRead;
+	uint64_t bytesSkipped;
+
+	/**
+	 * Write the checkpoint to a file, replacing any previous checkpoint atomically.  The new file is synced before it
+	 * replaces the old one, and the directory after, so a crash at any point leaves one complete checkpoint behind and
+	 * a saved one stays saved
+	 *
+	 * @param filename	The checkpoint file
+	 * @return			True if the checkpoint was saved
+	 */
+	bool Save(const std::string &filename) const
+	{
+		std::string tempFilename(filename + ".tmp");
+		FILE *file = fopen(tempFilename.c_str(), "wb");
+		if (file == NULL)
+			return false;
+
+		uint64_t version = VERSION;
+		bool saved = fwrite(Magic(), MAGIC_SIZE, 1, file) == 1 &&
+					 WriteInteger(file, version) &&
+					 WriteString(file, options) &&
+					 WriteInteger(file, searchComplete ? 1 : 0) &&
+					 WriteInteger(file, filesProcessed) &&
+					 WriteInteger(file, bytesRead) &&
+					 WriteInteger(file, bytesSkipped) &&
+					 WriteInteger(file, words.size());
+		for (size_t i = 0; saved && i < words.size(); ++i)
+			saved = WriteString(file, words[i].first) && WriteInteger(file, static_cast<uint64_t>(words[i].second));
+		saved = saved && WriteStrings(file, completedFiles) && WriteStrings(file, pendingFiles);
+
+		saved = (fflush(file) == 0) && (fsync(fileno(file)) == 0) && saved;
+		saved = (fclose(file) == 0) && saved;
+		if (!saved || rename(tempFilename.c_str(), filename.c_str()) != 0)
+		{
+			remove(tempFilename.c_str());
+			return false;
+		}
+		return SyncDirectory(filename);
+	}
+
+	/**
+	 * Read a checkpoint from a file
+	 *
+	 * @param filename	The checkpoint file
+	 * @return			True if a complete checkpoint was read; false for a missing, truncated or corrupt one
+	 */
+	bool Load(const std::string &filename)
+	{
+		FILE *file = fopen(filename.c_str(), "rb");
+		if (file == NULL)
+			return false;
+
+		// Every length and count in the file is checked against the bytes left in it, so a garbled one fails the load
+		// instead of asking for more memory than the file could ever fill
+		struct stat fileStat;
+		bool loaded = (fstat(fileno(file), &fileStat) == 0);
+		uint64_t remaining = (loaded ? static_cast<uint64_t>(fileStat.st_size) : 0);
+		try
+		{
+			char magic[MAGIC_SIZE];
+			uint64_t version = 0;
+			uint64_t complete = 0;
+			uint64_t wordCount = 0;
+			loaded = loaded &&
+					 ReadBytes(file, remaining, magic, MAGIC_SIZE) &&
+					 memcmp(magic, Magic(), MAGIC_SIZE) == 0 &&
+					 ReadInteger(file, remaining, version) && version == VERSION &&
+					 ReadString(file, remaining, options) &&
+					 ReadInteger(file, remaining, complete) &&
+					 ReadInteger(file, remaining, filesProcessed) &&
+					 ReadInteger(file, remaining, bytesRead) &&
+					 ReadInteger(file, remaining, bytesSkipped) &&
+					 ReadInteger(file, remaining, wordCount) &&
+					 wordCount <= remaining / (2 * sizeof(uint64_t));	// Each word has at least its length and count
+			searchComplete = (complete != 0);
+			words.clear();
+			if (loaded)
+				words.reserve(wordCount);
+			for (uint64_t i = 0; loaded && i < wordCount; ++i)
+			{
+				std::string word;
+				uint64_t count;
+				loaded = ReadString(file, remaining, word) && ReadInteger(file, remaining, count);
+				words.emplace_back(word, static_cast<int>(count));
+			}
+			loaded = loaded && ReadStrings(file, remaining, completedFiles) && ReadStrings(file, remaining, pendingFiles);
+		}
+		catch (const std::bad_alloc&)
+		{
+			loaded = false;
+		}
+		fclose(file);
+		return loaded;
+	}
+
+
+private:
+	static constexpr size_t MAGIC_SIZE = 8;
+	static constexpr uint64_t VERSION = 2;
+
+	static const char* Magic()
+	{
+		return "SSFICKPT";
+	}
+
+	static bool WriteInteger(FILE *file, const uint64_t &value)
+	{
+		return fwrite(&value, sizeof(value), 1, file) == 1;
+	}
+
+	/**
+	 * Read bytes, counting them off the bytes left in the file
+	 */
+	static bool ReadBytes(FILE *file, uint64_t &remaining, void *data, const uint64_t &length)
+	{
+		if (length > remaining || (length > 0 && fread(data, 1, length, file) != length))
+			return false;
+		remaining -= length;
+		return true;
+	}
+
+	static bool ReadInteger(FILE *file, uint64_t &remaining, uint64_t &value)
+	{
+		return ReadBytes(file, remaining, &value, sizeof(value));
+	}
+
+	static bool WriteString(FILE *file, const std::string &value)
+	{
+		return WriteInteger(file, value.size()) && fwrite(value.data(), 1, value.size(), file) == value.size();
+	}
+
+	static bool ReadString(FILE *file, uint64_t &remaining, std::string &value)
+	{
+		uint64_t length;
+		if (!ReadInteger(file, remaining, length) || length > remaining)
+			return false;
+		value.resize(length);
+		return ReadBytes(file, remaining, &value[0], length);
+	}
+
+	static bool WriteStrings(FILE *file, const std::vector<std::string> &values)
+	{
+		if (!WriteInteger(file, values.size()))
+			return false;
+		for (const auto &value : values)
+		{
+			if (!WriteString(file, value))
+				return false;
+		}
+		return true;
+	}
+
+	static bool ReadStrings(FILE *file, uint64_t &remaining, std::vector<std::string> &values)
+	{
+		uint64_t count;
+		if (!ReadInteger(file, remaining, count) || count > remaining / sizeof(uint64_t))	// Each string has at least its length
+			return false;
+		values.clear();
+		values.reserve(count);
+		for (uint64_t i = 0; i < count; ++i)
+		{
+			std::string value;
+			if (!ReadString(file, remaining, value))
+				return false;
+			values.push_back(value);
+		}
+		return true;
+	}
+
+	/**
+	 * Sync the directory holding a file, so a rename into it survives a crash
+	 */
+	static bool SyncDirectory(const std::string &filename)
+	{
+		size_t slash = filename.rfind('/');
+		std::string directory(slash == std::string::npos ? "." : (slash == 0 ? "/" : filename.substr(0, slash)));
+		int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+		if (fd == -1)
+			return false;
+		bool synced = (fsync(fd) == 0);
+		close(fd);
+		return synced;
+	}
+
+};
+
+#endif // CHECKPOINT_H
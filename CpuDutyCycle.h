@@ -0,0 +1,57 @@
+#ifndef CPUDUTYCYCLE_H
+#define CPUDUTYCYCLE_H
+
+#include <boost/thread/thread.hpp>
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * The CpuDutyCycle class holds the calling thread to a fraction of one CPU, by sleeping in proportion to the CPU time it
+ * has used since it last slept.  Not thread-safe; each thread needs its own instance
+ */
+class CpuDutyCycle
+{
+public:
+
+	/**
+	 * CpuDutyCycle constructor
+	 *
+	 * @param percent	The share of a CPU the thread may use, 1-100
+	 */
+	CpuDutyCycle(const int &percent = 100)
+		: mPercent(percent),
+		  mLastCpuNanos(ThreadCpuNanos())
+	{ }
+
+	/**
+	 * Sleep if the thread has used more than its share of the CPU.  Call this regularly from the thread's work loop
+	 */
+	void Check()
+	{
+		if (mPercent >= 100)
+			return;
+
+		// Sleep in slices of at least SLICE_NANOS of work, so the sleeps are long enough for the scheduler to honor
+		int64_t busy = ThreadCpuNanos() - mLastCpuNanos;
+		if (busy < SLICE_NANOS)
+			return;
+		boost::this_thread::sleep_for(boost::chrono::nanoseconds(busy * (100 - mPercent) / mPercent));
+		mLastCpuNanos = ThreadCpuNanos();
+	}
+
+
+private:
+	static constexpr int64_t SLICE_NANOS = 10 * 1000 * 1000;
+	int mPercent;
+	int64_t mLastCpuNanos;
+
+	static int64_t ThreadCpuNanos()
+	{
+		struct timespec now;
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+		return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+	}
+
+};
+
+#endif // CPUDUTYCYCLE_H
@@ -0,0 +1,25 @@
+#ifndef CRAWLSTATS_H
+#define CRAWLSTATS_H
+
+#include <atomic>
+#include <stdint.h>
+
+/**
+ * Running totals for a crawl, updated by the file processing threads
+ */
+struct CrawlStats
+{
+	CrawlStats()
+		: filesProcessed(0),
+		  bytesRead(0),
+		  bytesSkipped(0),
+		  bytesFound(0)
+	{ }
+
+	std::atomic<uint64_t> filesProcessed;	// The number of files that were opened and read
+	std::atomic<uint64_t> bytesRead;		// The number of bytes read from those files
+	std::atomic<uint64_t> bytesSkipped;		// The number of bytes in sparse file holes that were skipped instead of read
+	std::atomic<uint64_t> bytesFound;		// The total size of the files handed out for processing
+};
+
+#endif // CRAWLSTATS_H
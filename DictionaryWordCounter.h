@@ -0,0 +1,377 @@
+#ifndef DICTIONARYWORDCOUNTER_H
+#define DICTIONARYWORDCOUNTER_H
+
+#include <algorithm>
+#include <atomic>
+#include <boost/thread/mutex.hpp>
+#include <functional>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "WordAccumulator.h"
+
+/**
+ * The DictionaryWordCounter class counts words by number.  A shared dictionary gives each unique word a dense ID the first
+ * time any thread finds it and holds the only copy of the word, stored by ID.  The dictionary's tables hold just a tag
+ * from each word's hash and its ID, and are read without a lock; only adding a word takes one, of many.  Each thread
+ * counts in an array of its own indexed by ID, through a Writer, so a word that's already in the dictionary costs a
+ * probe, a compare against the stored word and an increment, and nothing per word is written to shared memory.  Words
+ * get IDs roughly in the order they are first found, so the common words have low IDs and sit together in memory.  When
+ * a thread is done its counts are added to the totals element by element.  Thread-safe, with one Writer per thread that
+ * adds words
+ */
+class DictionaryWordCounter
+{
+	struct ShardTable;
+
+public:
+
+	/**
+	 * The per-thread side of a DictionaryWordCounter.  Not thread-safe; one per thread
+	 */
+	class Writer
+	{
+	public:
+
+		Writer()
+			: mPending(0)
+		{ }
+
+		/**
+		 * Count an occurance of a word.  Words are held back and counted BATCH_WORDS at a time, so the dictionary and
+		 * count reads for a batch can all be in flight together
+		 *
+		 * @param word		The word
+		 * @param counter	The counter whose dictionary numbers the word
+		 */
+		void AddWord(const std::string &word, DictionaryWordCounter &counter)
+		{
+			size_t hash = counter.Hash(word);
+			mWords[mPending].assign(word);
+			mHashes[mPending] = hash;
+			if (++mPending == BATCH_WORDS)
+				CountPending(counter);
+		}
+
+		/**
+		 * Add the counts so far to the counter's totals and start again from zero
+		 *
+		 * @param counter	The counter the counts go to
+		 */
+		void Flush(DictionaryWordCounter &counter)
+		{
+			CountPending(counter);
+			counter.Merge(mCounts);
+			mCounts.assign(mCounts.size(), 0);
+		}
+
+	private:
+		static constexpr size_t BATCH_WORDS = 32;
+
+		std::vector<int> mCounts;			// Indexed by ID
+		std::string mWords[BATCH_WORDS];	// Reused, so words usually fit without allocating
+		size_t mHashes[BATCH_WORDS];
+		const ShardTable* mTables[BATCH_WORDS];
+		size_t mPending;
+
+		void CountPending(DictionaryWordCounter &counter)
+		{
+			// Each step fetches what the next one reads, for the whole batch at once
+			for (size_t i = 0; i < mPending; ++i)
+			{
+				mTables[i] = counter.TableOf(mHashes[i]);
+				__builtin_prefetch(&mTables[i]->slots[Home(*mTables[i], mHashes[i])]);
+			}
+			for (size_t i = 0; i < mPending; ++i)
+			{
+				uint64_t slot = mTables[i]->slots[Home(*mTables[i], mHashes[i])].load(std::memory_order_acquire);
+				if (slot != 0 && SameTag(slot, mHashes[i]))
+				{
+					__builtin_prefetch(&counter.Word(IdOf(slot)));
+					if (IdOf(slot) < mCounts.size())
+						__builtin_prefetch(&mCounts[IdOf(slot)], 1);
+				}
+			}
+			for (size_t i = 0; i < mPending; ++i)
+			{
+				size_t index;
+				uint32_t id = counter.Find(*mTables[i], mWords[i], mHashes[i], index);
+				if (id == NO_ID)
+					id = counter.Add(mWords[i], mHashes[i]);
+				if (id >= mCounts.size())
+					mCounts.resize(std::max<size_t>(id + 1, mCounts.size() * 2), 0);
+				mCounts[id]++;
+			}
+			mPending = 0;
+		}
+
+		// No copying
+		Writer(const Writer&);
+		Writer& operator=(const Writer& other);
+	};
+
+	/**
+	 * DictionaryWordCounter constructor
+	 */
+	DictionaryWordCounter()
+		: mShards(SHARD_COUNT),
+		  mWords(new std::unique_ptr<std::string[]>[WORD_CHUNKS]),
+		  mNextId(0)
+	{ }
+
+	/**
+	 * Remove all words.  Writers that have looked words up must not be used again, and no thread may be adding words
+	 */
+	void ClearResults()
+	{
+		for (auto &shard : mShards)
+		{
+			boost::mutex::scoped_lock lock(shard.mutex);
+			shard.Reset();
+		}
+		{
+			boost::mutex::scoped_lock lock(mIdMutex);
+			for (uint32_t chunk = 0; chunk * CHUNK_WORDS < mNextId; ++chunk)
+				mWords[chunk].reset();
+			mNextId = 0;
+		}
+		boost::mutex::scoped_lock lock(mTotalsMutex);
+		mTotals.clear();
+	}
+
+	/**
+	 * Get the top occurring words.  Only counts from flushed Writers are included
+	 *
+	 * @param count	The number of words to return
+	 * @return		Up to count words, sorted from highest occurance to lowest
+	 */
+	std::vector<WordCountType> ListTopWords(const int &count) const
+	{
+		std::vector<uint32_t> ids;
+		std::vector<int> totals;
+		{
+			boost::mutex::scoped_lock lock(mTotalsMutex);
+			totals = mTotals;
+		}
+		for (uint32_t id = 0; id < totals.size(); ++id)
+		{
+			if (totals[id] > 0)
+				ids.push_back(id);
+		}
+		size_t keep = std::min(static_cast<size_t>(count), ids.size());
+		std::partial_sort(ids.begin(),
+						  ids.begin() + keep,
+						  ids.end(),
+						  [&totals](const uint32_t &a, const uint32_t &b)
+						  {
+							  return totals[a] > totals[b];
+						  });
+		ids.resize(keep);
+
+		std::vector<WordCountType> topWords;
+		topWords.reserve(keep);
+		for (uint32_t id : ids)
+			topWords.emplace_back(Word(id), totals[id]);
+		return topWords;
+	}
+
+	/**
+	 * Hash a word the way the dictionary does
+	 */
+	size_t Hash(const std::string &word) const
+	{
+		return mHasher(word);
+	}
+
+	/**
+	 * Get the number of unique words
+	 */
+	size_t GetUniqueWordCount() const
+	{
+		boost::mutex::scoped_lock lock(mIdMutex);
+		return mNextId;
+	}
+
+
+private:
+	static constexpr size_t SHARD_COUNT = 1024;	// Dictionary locks, so threads adding words rarely wait on each other
+	static constexpr size_t SHARD_SLOTS = 64;	// The starting size of a shard's table; must be a power of two
+	static constexpr uint32_t NO_ID = 0xFFFFFFFF;
+	static constexpr size_t CHUNK_BITS = 16;
+	static constexpr size_t CHUNK_WORDS = size_t(1) << CHUNK_BITS;	// Words are stored in chunks that never move
+	static constexpr size_t WORD_CHUNKS = (size_t(NO_ID) + 1) / CHUNK_WORDS;
+
+	/**
+	 * An open addressing table of IDs.  A slot packs the top half of its word's hash, which both places it and skips
+	 * most compares against the stored word, with the ID plus one, so zero is an empty slot.  A slot never changes once
+	 * it is filled
+	 */
+	struct ShardTable
+	{
+		explicit ShardTable(const size_t &capacity)
+			: mask(capacity - 1),
+			  slots(new std::atomic<uint64_t>[capacity]())
+		{ }
+
+		const size_t mask;
+		std::unique_ptr<std::atomic<uint64_t>[]> slots;
+	};
+
+	/**
+	 * One lock's share of the dictionary.  When its table fills past half it is replaced by one twice the size; the old
+	 * tables are kept until the dictionary is cleared, since threads may still be reading them.  A word missing from an
+	 * old table is looked for again in the current one under the lock before it is added
+	 */
+	struct Shard
+	{
+		Shard()
+		{
+			Reset();
+		}
+
+		void Reset()
+		{
+			tables.clear();
+			tables.emplace_back(new ShardTable(SHARD_SLOTS));
+			current.store(tables.back().get(), std::memory_order_release);
+			size = 0;
+		}
+
+		std::atomic<ShardTable*> current;
+		std::vector<std::unique_ptr<ShardTable> > tables;	// Every table the shard has had; guarded by mutex
+		size_t size;										// Guarded by mutex
+		mutable boost::mutex mutex;
+	};
+
+	std::vector<Shard> mShards;
+	std::hash<std::string> mHasher;
+	// Each word by ID, in chunks allocated as IDs are handed out.  A word is written before its ID is put in a table and
+	// never changes after, so anyone who read the ID from a table can read the word
+	std::unique_ptr<std::unique_ptr<std::string[]>[]> mWords;
+	mutable boost::mutex mIdMutex;
+	uint32_t mNextId;				// Guarded by mIdMutex
+	mutable boost::mutex mTotalsMutex;
+	std::vector<int> mTotals;		// Indexed by ID, guarded by mTotalsMutex
+
+	static uint64_t Pack(const size_t &hash, const uint32_t &id)
+	{
+		return (hash & 0xFFFFFFFF00000000ULL) | (static_cast<uint64_t>(id) + 1);
+	}
+
+	static uint32_t IdOf(const uint64_t &slot)
+	{
+		return static_cast<uint32_t>(slot) - 1;
+	}
+
+	static bool SameTag(const uint64_t &slot, const size_t &hash)
+	{
+		return (slot >> 32) == (hash >> 32);
+	}
+
+	static size_t Home(const ShardTable &table, const size_t &hash)
+	{
+		return (hash >> 32) & table.mask;
+	}
+
+	/**
+	 * Get the word with an ID read from a table
+	 */
+	const std::string& Word(const uint32_t &id) const
+	{
+		return mWords[id >> CHUNK_BITS][id & (CHUNK_WORDS - 1)];
+	}
+
+	/**
+	 * Get the table to look a word up in without a lock
+	 */
+	const ShardTable* TableOf(const size_t &hash) const
+	{
+		return mShards[hash % SHARD_COUNT].current.load(std::memory_order_acquire);
+	}
+
+	/**
+	 * Find a word in a table
+	 *
+	 * @return	The word's ID, or NO_ID with index set to the empty slot it would go in
+	 */
+	uint32_t Find(const ShardTable &table, const std::string &word, const size_t &hash, size_t &index) const
+	{
+		for (index = Home(table, hash); ; index = (index + 1) & table.mask)
+		{
+			uint64_t slot = table.slots[index].load(std::memory_order_acquire);
+			if (slot == 0)
+				return NO_ID;
+			if (SameTag(slot, hash) && Word(IdOf(slot)) == word)
+				return IdOf(slot);
+		}
+	}
+
+	/**
+	 * Get the ID of a word that wasn't in the table it was looked up in, giving it the next one if it still isn't in the
+	 * shard's current table
+	 */
+	uint32_t Add(const std::string &word, const size_t &hash)
+	{
+		Shard &shard = mShards[hash % SHARD_COUNT];
+		boost::mutex::scoped_lock lock(shard.mutex);
+		ShardTable &table = *shard.tables.back();
+		size_t index;
+		uint32_t id = Find(table, word, hash, index);
+		if (id != NO_ID)
+			return id;
+
+		{
+			boost::mutex::scoped_lock idLock(mIdMutex);
+			id = mNextId++;
+			std::unique_ptr<std::string[]> &chunk = mWords[id >> CHUNK_BITS];
+			if (!chunk)
+				chunk.reset(new std::string[CHUNK_WORDS]);
+		}
+		mWords[id >> CHUNK_BITS][id & (CHUNK_WORDS - 1)] = word;
+		table.slots[index].store(Pack(hash, id), std::memory_order_release);
+		if (++shard.size * 2 > table.mask + 1)
+			Grow(shard);
+		return id;
+	}
+
+	/**
+	 * Replace a shard's table with one twice the size.  Called with the shard's lock held
+	 */
+	static void Grow(Shard &shard)
+	{
+		const ShardTable &old = *shard.tables.back();
+		std::unique_ptr<ShardTable> table(new ShardTable((old.mask + 1) * 2));
+		for (size_t i = 0; i <= old.mask; ++i)
+		{
+			uint64_t slot = old.slots[i].load(std::memory_order_relaxed);
+			if (slot == 0)
+				continue;
+			size_t j = Home(*table, slot);
+			while (table->slots[j].load(std::memory_order_relaxed) != 0)
+				j = (j + 1) & table->mask;
+			table->slots[j].store(slot, std::memory_order_relaxed);
+		}
+		shard.current.store(table.get(), std::memory_order_release);
+		shard.tables.push_back(std::move(table));
+	}
+
+	/**
+	 * Add a thread's counts to the totals
+	 */
+	void Merge(const std::vector<int> &counts)
+	{
+		boost::mutex::scoped_lock lock(mTotalsMutex);
+		if (mTotals.size() < counts.size())
+			mTotals.resize(counts.size(), 0);
+		for (size_t id = 0; id < counts.size(); ++id)
+			mTotals[id] += counts[id];
+	}
+
+	// No copying
+	DictionaryWordCounter(const DictionaryWordCounter&);
+	DictionaryWordCounter& operator=(const DictionaryWordCounter& other);
+
+};
+
+#endif // DICTIONARYWORDCOUNTER_H
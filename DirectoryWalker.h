@@ -0,0 +1,403 @@
+#ifndef DIRECTORYWALKER_H
+#define DIRECTORYWALKER_H
+
+#include <deque>
+#include <dirent.h>
+#include <errno.h>
+#include <iostream>
+#include <string.h>
+#include <string>
+#include <sys/stat.h>
+#include <utility>
+#include <vector>
+#include "FileEntry.h"
+#include "TraversalCache.h"
+
+/**
+ * The order in which a DirectoryWalker visits directories
+ */
+enum class TraversalOrder
+{
+	DepthFirst,		// Descend into each subdirectory as it is found, like a recursive search; keeps related files together
+	BreadthFirst	// Finish each directory before moving on to the next one at the same depth; one directory open at a time
+};
+
+/**
+ * The DirectoryWalker class finds the regular files under a path without recursion, using an explicit stack or queue of
+ * directories, and with a cap on the number of directories held open at once.  Given a TraversalCache, it reuses the
+ * listing of directories that have not changed since the cached walk and records the new walk in it
+ */
+class DirectoryWalker
+{
+public:
+
+	/**
+	 * DirectoryWalker constructor
+	 *
+	 * @param order					The order to visit directories in
+	 * @param maxOpenDirectories	The most directory descriptors to hold open at once during a depth first walk
+	 * @param cache					The snapshot to reuse and record listings in, or NULL to always read directories
+	 */
+	DirectoryWalker(const TraversalOrder &order = TraversalOrder::DepthFirst, const size_t &maxOpenDirectories = 64, TraversalCache *cache = NULL)
+		: mOrder(order),
+		  mMaxOpenDirectories(maxOpenDirectories > 0 ? maxOpenDirectories : 1),
+		  mCache(cache),
+		  mStopped(false)
+	{ }
+
+	/**
+	 * Walk a directory tree, calling onFile for each regular file
+	 *
+	 * @param basePath	The path to start at
+	 * @param onFile	Called as onFile(const FileEntry &file) for every regular file; returning false stops the walk
+	 * @return			False if the walk was stopped early by onFile or the starting path couldn't be read, in which case
+	 * 					the cache is incomplete and should not be saved
+	 */
+	template<typename FileCallback>
+	bool Walk(const std::string &basePath, FileCallback onFile)
+	{
+		mStopped = false;
+		struct stat baseStat;
+		if (stat(basePath.c_str(), &baseStat) != 0)
+		{
+			int err = errno;
+			std::cout << "Failed to open directory '" << basePath << "': [" << err << "] " << strerror(err) << std::endl;
+			return false;
+		}
+
+		bool opened;
+		if (mOrder == TraversalOrder::BreadthFirst)
+			opened = WalkBreadthFirst(basePath, baseStat, onFile);
+		else
+			opened = WalkDepthFirst(basePath, baseStat, onFile);
+		return opened && !mStopped;
+	}
+
+
+private:
+
+	/**
+	 * What is known about a directory entry before it is visited
+	 */
+	enum class EntryType
+	{
+		Unknown,	// Read from the directory, still needs an lstat
+		File,		// A regular file, from the cache
+		Directory	// A subdirectory, from the cache
+	};
+
+	struct Entry
+	{
+		Entry()
+			: type(EntryType::Unknown),
+			  inode(0),
+			  size(0)
+		{ }
+
+		Entry(const std::string &entryName, const EntryType &entryType, const ino_t &entryInode = 0, const off_t &entrySize = 0)
+			: name(entryName),
+			  type(entryType),
+			  inode(entryInode),
+			  size(entrySize)
+		{ }
+
+		std::string name;
+		EntryType type;
+		ino_t inode;
+		off_t size;
+	};
+
+	/**
+	 * A directory being walked.  While open it is read through dir; otherwise its remaining entries are in entries, either
+	 * from the cache or because it was closed to make room for a deeper directory
+	 */
+	struct Frame
+	{
+		Frame(const std::string &directoryPath)
+			: path(directoryPath),
+			  dir(NULL),
+			  nextEntry(0),
+			  snapshotIndex(TraversalCache::NO_PARENT)
+		{ }
+
+		std::string path;
+		DIR *dir;
+		std::vector<Entry> entries;
+		size_t nextEntry;
+		uint32_t snapshotIndex;		// Index of the directory in the cache's new snapshot
+	};
+
+	TraversalOrder mOrder;
+	size_t mMaxOpenDirectories;
+	TraversalCache *mCache;
+	bool mStopped;		// The file callback asked for the walk to stop
+
+	/**
+	 * Visit directories depth first, holding at most mMaxOpenDirectories open
+	 *
+	 * @return	False if the starting directory couldn't be opened
+	 */
+	template<typename FileCallback>
+	bool WalkDepthFirst(const std::string &basePath, const struct stat &baseStat, FileCallback &onFile)
+	{
+		std::vector<Frame> stack;
+		size_t openCount = 0;
+		size_t oldestOpen = 0;	// Every frame below this one has already been closed
+
+		stack.emplace_back(basePath);
+		if (!OpenFrame(stack.back(), TraversalCache::NO_PARENT, basePath, baseStat))
+			return false;
+		if (stack.back().dir != NULL)
+			openCount++;
+
+		Entry entry;
+		std::string entryPath;
+		struct stat entryStat;
+		while (!stack.empty() && !mStopped)
+		{
+			Frame &frame = stack.back();
+			if (!NextEntry(frame, entry))
+			{
+				if (frame.dir != NULL)
+				{
+					closedir(frame.dir);
+					openCount--;
+				}
+				stack.pop_back();
+				if (oldestOpen > stack.size())
+					oldestOpen = stack.size();
+				continue;
+			}
+
+			if (!VisitEntry(frame, entry, entryPath, entryStat, onFile))
+				continue;
+
+			// Make room for the subdirectory by closing the directory we will come back to last, keeping the rest of its
+			// entries in memory
+			if (openCount >= mMaxOpenDirectories)
+			{
+				while (stack[oldestOpen].dir == NULL)
+					oldestOpen++;
+				Spill(stack[oldestOpen]);
+				openCount--;
+			}
+
+			uint32_t parentIndex = frame.snapshotIndex;
+			stack.emplace_back(entryPath);
+			if (!OpenFrame(stack.back(), parentIndex, entry.name, entryStat))
+				stack.pop_back();
+			else if (stack.back().dir != NULL)
+				openCount++;
+		}
+
+		// Anything left on the stack was abandoned by a stop
+		for (auto &frame : stack)
+		{
+			if (frame.dir != NULL)
+				closedir(frame.dir);
+		}
+		return true;
+	}
+
+	/**
+	 * Visit directories breadth first.  Each directory is read completely and closed before the next one is opened
+	 *
+	 * @return	False if the starting directory couldn't be opened
+	 */
+	template<typename FileCallback>
+	bool WalkBreadthFirst(const std::string &basePath, const struct stat &baseStat, FileCallback &onFile)
+	{
+		// Each queued directory carries what OpenFrame needs: its parent's snapshot index, its name and its stat
+		struct Pending
+		{
+			std::string path;
+			uint32_t parentIndex;
+			std::string name;
+			struct stat dirStat;
+		};
+		std::deque<Pending> queue;
+		queue.push_back(Pending { basePath, TraversalCache::NO_PARENT, basePath, baseStat });
+
+		Entry entry;
+		std::string entryPath;
+		struct stat entryStat;
+		bool first = true;
+		while (!queue.empty() && !mStopped)
+		{
+			Pending pending(std::move(queue.front()));
+			queue.pop_front();
+
+			Frame frame(pending.path);
+			if (!OpenFrame(frame, pending.parentIndex, pending.name, pending.dirStat))
+			{
+				if (first)
+					return false;
+				continue;
+			}
+			first = false;
+
+			while (!mStopped && NextEntry(frame, entry))
+			{
+				if (VisitEntry(frame, entry, entryPath, entryStat, onFile))
+					queue.push_back(Pending { entryPath, frame.snapshotIndex, entry.name, entryStat });
+			}
+			if (frame.dir != NULL)
+				closedir(frame.dir);
+		}
+		return true;
+	}
+
+	/**
+	 * Start walking a directory, from the cache if it is unchanged or by opening it otherwise, and record it in the cache
+	 *
+	 * @param frame			The directory; its path is set
+	 * @param parentIndex	The snapshot index of the parent directory
+	 * @param name			The name of the directory within its parent
+	 * @param dirStat		The stat of the directory
+	 * @return				True if the directory can be walked
+	 */
+	bool OpenFrame(Frame &frame, uint32_t parentIndex, const std::string &name, const struct stat &dirStat)
+	{
+		TraversalCache::Listing listing;
+		if (mCache != NULL && mCache->Lookup(frame.path, dirStat, listing))
+		{
+			frame.entries.reserve(listing.files.size() + listing.subdirectories.size());
+			for (const auto &file : listing.files)
+				frame.entries.emplace_back(file.name, EntryType::File, file.inode, file.size);
+			for (const auto &subdirectory : listing.subdirectories)
+				frame.entries.emplace_back(subdirectory, EntryType::Directory);
+		}
+		else
+		{
+			frame.dir = OpenDirectory(frame.path);
+			if (frame.dir == NULL)
+			{
+				// Keep it in its parent's listing so it is tried again once it can be read, even if the parent is reused
+				if (mCache != NULL)
+					mCache->AddDirectory(parentIndex, name, dirStat, false);
+				return false;
+			}
+		}
+
+		if (mCache != NULL)
+			frame.snapshotIndex = mCache->AddDirectory(parentIndex, name, dirStat);
+		return true;
+	}
+
+	/**
+	 * Look at a directory entry, calling onFile if it is a regular file and setting mStopped if onFile returns false
+	 *
+	 * @param frame		The directory holding the entry
+	 * @param entry		The entry
+	 * @param entryPath	Set to the full path of the entry
+	 * @param entryStat	Set to the stat of the entry, if it is a directory
+	 * @param onFile	The file callback
+	 * @return			True if the entry is a directory that should be walked
+	 */
+	template<typename FileCallback>
+	bool VisitEntry(const Frame &frame, const Entry &entry, std::string &entryPath, struct stat &entryStat, FileCallback &onFile)
+	{
+		entryPath.assign(frame.path + "/" + entry.name);
+		if (entry.type == EntryType::File)
+		{
+			AddFile(frame, entry.name, entry.inode, entry.size);
+			mStopped = !onFile(FileEntry(entryPath, entry.inode, entry.size));
+			return false;
+		}
+
+		// Make sure the file exists and is readable
+		if (lstat(entryPath.c_str(), &entryStat) != 0)
+			return false;
+
+		// This implementation ignores symlinks.  It's not clear from the requirements if following symlinks is required,
+		// so I am leaving that functionality out so as to not have to deal with all of the ways symlinks can be broken,
+		// links to links, circular links, and any other link madness that is possible in Linux.
+		// This means that the results of this searcher are the same as the command 'find <basePath> -type f -name "*.txt"'
+		if (S_ISLNK(entryStat.st_mode))
+			return false;
+
+		if (S_ISREG(entryStat.st_mode))
+		{
+			AddFile(frame, entry.name, entryStat.st_ino, entryStat.st_size);
+			mStopped = !onFile(FileEntry(entryPath, entryStat.st_ino, entryStat.st_size));
+			return false;
+		}
+		return S_ISDIR(entryStat.st_mode);
+	}
+
+	/**
+	 * Record a regular file in the cache, if there is one
+	 */
+	void AddFile(const Frame &frame, const std::string &name, const ino_t &inode, const off_t &size)
+	{
+		if (mCache != NULL)
+			mCache->AddFile(frame.snapshotIndex, name, inode, size);
+	}
+
+	/**
+	 * Get the next entry in a directory, skipping . and ..
+	 *
+	 * @param frame	The directory
+	 * @param entry	Set to the entry
+	 * @return		True if there was another entry
+	 */
+	static bool NextEntry(Frame &frame, Entry &entry)
+	{
+		if (frame.dir == NULL)
+		{
+			if (frame.nextEntry >= frame.entries.size())
+				return false;
+			entry = std::move(frame.entries[frame.nextEntry++]);
+			return true;
+		}
+
+		struct dirent *dirEntry;
+		while ((dirEntry = readdir(frame.dir)) != NULL)
+		{
+			if (strcmp(dirEntry->d_name, ".") == 0 || strcmp(dirEntry->d_name, "..") == 0)
+				continue;
+			entry.name.assign(dirEntry->d_name);
+			entry.type = EntryType::Unknown;
+			return true;
+		}
+		return false;
+	}
+
+	/**
+	 * Read the rest of an open directory into memory and close it
+	 *
+	 * @param frame	The directory
+	 */
+	static void Spill(Frame &frame)
+	{
+		Entry entry;
+		while (NextEntry(frame, entry))
+			frame.entries.push_back(entry);
+		closedir(frame.dir);
+		frame.dir = NULL;
+	}
+
+	/**
+	 * Open a directory, reporting any failure
+	 *
+	 * @param path	The path of the directory
+	 * @return		The open directory, or NULL
+	 */
+	static DIR* OpenDirectory(const std::string &path)
+	{
+		DIR *dir = opendir(path.c_str());
+		if (dir == NULL)
+		{
+			int err = errno;
+			std::cout << "Failed to open directory '" << path << "': [" << err << "] " << strerror(err) << std::endl;
+		}
+		return dir;
+	}
+
+	// No copying
+	DirectoryWalker(const DirectoryWalker&);
+	DirectoryWalker& operator=(const DirectoryWalker& other);
+
+};
+
+#endif // DIRECTORYWALKER_H
@@ -0,0 +1,28 @@
+#ifndef FILEENTRY_H
+#define FILEENTRY_H
+
+#include <string>
+#include <sys/types.h>
+
+/**
+ * A file found during the search that is waiting to be processed
+ */
+struct FileEntry
+{
+	FileEntry()
+		: inode(0),
+		  size(0)
+	{ }
+
+	FileEntry(const std::string &filePath, const ino_t &fileInode, const off_t &fileSize)
+		: path(filePath),
+		  inode(fileInode),
+		  size(fileSize)
+	{ }
+
+	std::string path;	// The full path/name of the file
+	ino_t inode;		// The inode number of the file, from lstat
+	off_t size;			// The size of the file when it was found
+};
+
+#endif // FILEENTRY_H
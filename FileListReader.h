@@ -0,0 +1,146 @@
+#ifndef FILELISTREADER_H
+#define FILELISTREADER_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * The FileListReader class streams paths out of a newline or NUL delimited list, such as the output of 'find -print0',
+ * handing each one out as soon as it has been read rather than waiting for the whole list
+ */
+class FileListReader
+{
+public:
+
+	/**
+	 * FileListReader constructor
+	 *
+	 * @param listPath	The file to read the list from, or "-" for stdin
+	 * @param delimiter	The character that ends each path, '\n' or '\0'
+	 */
+	FileListReader(const std::string &listPath, const char &delimiter = '\n')
+		: mListPath(listPath),
+		  mDelimiter(delimiter),
+		  mFd(-1),
+		  mError(0),
+		  mBuffer(READ_SIZE),
+		  mStart(0),
+		  mEnd(0),
+		  mEof(false)
+	{ }
+
+	/**
+	 * FileListReader destructor
+	 */
+	~FileListReader()
+	{
+		if (mFd > STDIN_FILENO)
+			close(mFd);
+	}
+
+	/**
+	 * Open the list for reading
+	 *
+	 * @return	True if the list was opened, false otherwise (see GetError)
+	 */
+	bool Open()
+	{
+		if (mListPath == "-")
+		{
+			mFd = STDIN_FILENO;
+			return true;
+		}
+
+		mFd = open(mListPath.c_str(), O_RDONLY);
+		if (mFd < 0)
+		{
+			mError = errno;
+			return false;
+		}
+		posix_fadvise(mFd, 0, 0, POSIX_FADV_SEQUENTIAL);
+		return true;
+	}
+
+	/**
+	 * Get the next path from the list.  Empty entries are skipped, and a final path without a delimiter is still returned
+	 *
+	 * @param path	Set to the next path
+	 * @return		True if a path was read, false at the end of the list or on error (see GetError)
+	 */
+	bool Next(std::string &path)
+	{
+		while (true)
+		{
+			// Hand out the next complete entry in the buffer
+			char *start = mBuffer.data() + mStart;
+			char *delimiter = static_cast<char*>(memchr(start, mDelimiter, mEnd - mStart));
+			if (delimiter != NULL)
+			{
+				path.assign(start, delimiter);
+				mStart += (delimiter - start) + 1;
+				if (path.empty())
+					continue;
+				return true;
+			}
+
+			if (mEof)
+			{
+				path.assign(start, mEnd - mStart);
+				mStart = mEnd;
+				return !path.empty();
+			}
+
+			// Move the partial entry to the front and read more behind it.  A path longer than the buffer grows it
+			memmove(mBuffer.data(), start, mEnd - mStart);
+			mEnd -= mStart;
+			mStart = 0;
+			if (mEnd == mBuffer.size())
+				mBuffer.resize(mBuffer.size() * 2);
+
+			ssize_t bytesRead = read(mFd, mBuffer.data() + mEnd, mBuffer.size() - mEnd);
+			if (bytesRead < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				mError = errno;
+				return false;
+			}
+			if (bytesRead == 0)
+				mEof = true;
+			mEnd += bytesRead;
+		}
+	}
+
+	/**
+	 * Get the error from the last failed operation
+	 *
+	 * @return	The errno value, or 0 if nothing has failed
+	 */
+	int GetError() const
+	{
+		return mError;
+	}
+
+
+private:
+	static constexpr size_t READ_SIZE = 64 * 1024;
+	std::string mListPath;
+	char mDelimiter;
+	int mFd;
+	int mError;
+	std::vector<char> mBuffer;
+	size_t mStart;		// The start of the unread entries in mBuffer
+	size_t mEnd;		// The end of the data in mBuffer
+	bool mEof;
+
+	// No copying
+	FileListReader(const FileListReader&);
+	FileListReader& operator=(const FileListReader& other);
+
+};
+
+#endif // FILELISTREADER_H
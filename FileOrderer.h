@@ -0,0 +1,157 @@
+#ifndef FILEORDERER_H
+#define FILEORDERER_H
+
+#include <algorithm>
+#include <fcntl.h>
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <stdint.h>
+#include <string>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+#include "FileEntry.h"
+
+/**
+ * The order in which found files are handed to the file processing threads
+ */
+enum class FileOrder
+{
+	Readdir,	// The order readdir returns the entries in
+	Inode,		// Ascending inode number, which loosely follows on-disk placement on most filesystems
+	Extent		// Ascending physical offset of the first extent of each file, from the FIEMAP ioctl
+};
+
+/**
+ * The FileOrderer class collects found files into batches and releases each batch sorted by where the files live on disk,
+ * so that rotational disks read them in one sweep instead of seeking back and forth
+ */
+class FileOrderer
+{
+public:
+
+	/**
+	 * FileOrderer constructor
+	 *
+	 * @param order		How to sort each batch
+	 * @param batchSize	The number of files to collect before a batch is released
+	 */
+	FileOrderer(const FileOrder &order, const size_t &batchSize)
+		: mOrder(order),
+		  mBatchSize(batchSize)
+	{
+		mBatch.reserve(mBatchSize);
+	}
+
+	/**
+	 * Add a file to the current batch
+	 *
+	 * @param file	The file to add
+	 * @return		True if the batch is now full and should be released with TakeBatch
+	 */
+	bool AddFile(const FileEntry &file)
+	{
+		mBatch.push_back(file);
+		return mBatch.size() >= mBatchSize;
+	}
+
+	/**
+	 * Sort the current batch and hand it over, leaving an empty batch behind
+	 *
+	 * @return	The files in the batch, in the order they should be processed
+	 */
+	std::vector<FileEntry> TakeBatch()
+	{
+		std::vector<FileEntry> batch;
+		batch.swap(mBatch);
+		mBatch.reserve(mBatchSize);
+
+		if (mOrder == FileOrder::Inode)
+		{
+			std::sort(batch.begin(),
+					  batch.end(),
+					  [](const FileEntry &a, const FileEntry &b)
+					  {
+						  return a.inode < b.inode;
+					  });
+		}
+		else if (mOrder == FileOrder::Extent)
+		{
+			SortByExtent(batch);
+		}
+		return batch;
+	}
+
+
+private:
+	FileOrder mOrder;
+	size_t mBatchSize;
+	std::vector<FileEntry> mBatch;
+
+	/**
+	 * Sort a batch by the physical offset of the first extent of each file.  Files the filesystem cannot map (no FIEMAP
+	 * support, no allocated extents, data stored inline) go after the mapped ones, ordered by inode
+	 *
+	 * @param batch	The files to sort
+	 */
+	static void SortByExtent(std::vector<FileEntry> &batch)
+	{
+		// Pair each file's sort key with its position in the batch, so the sort only moves the keys around
+		std::vector<std::pair<std::pair<bool, uint64_t>, size_t> > keys;
+		keys.reserve(batch.size());
+		for (size_t i = 0; i < batch.size(); ++i)
+		{
+			uint64_t physical = 0;
+			if (GetFirstExtent(batch[i].path, physical))
+				keys.emplace_back(std::make_pair(false, physical), i);
+			else
+				keys.emplace_back(std::make_pair(true, static_cast<uint64_t>(batch[i].inode)), i);
+		}
+		std::sort(keys.begin(), keys.end());
+
+		std::vector<FileEntry> sorted;
+		sorted.reserve(batch.size());
+		for (const auto &key : keys)
+			sorted.push_back(std::move(batch[key.second]));
+		batch.swap(sorted);
+	}
+
+	/**
+	 * Look up the physical location of the first extent of a file
+	 *
+	 * @param filename	The full path/name of the file
+	 * @param physical	Set to the byte offset of the first extent on the underlying device
+	 * @return			True if the offset was found, false if the file could not be mapped
+	 */
+	static bool GetFirstExtent(const std::string &filename, uint64_t &physical)
+	{
+		int fd = open(filename.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+
+		// struct fiemap ends in a flexible array of extents; we only ask for the first one
+		std::vector<uint64_t> request((sizeof(struct fiemap) + sizeof(struct fiemap_extent) + sizeof(uint64_t) - 1) / sizeof(uint64_t), 0);
+		struct fiemap *map = reinterpret_cast<struct fiemap*>(request.data());
+		map->fm_start = 0;
+		map->fm_length = FIEMAP_MAX_OFFSET;
+		map->fm_extent_count = 1;
+
+		bool found = false;
+		if (ioctl(fd, FS_IOC_FIEMAP, map) == 0 && map->fm_mapped_extents > 0 &&
+			(map->fm_extents[0].fe_flags & FIEMAP_EXTENT_UNKNOWN) == 0)
+		{
+			physical = map->fm_extents[0].fe_physical;
+			found = true;
+		}
+		close(fd);
+		return found;
+	}
+
+	// No copying
+	FileOrderer(const FileOrderer&);
+	FileOrderer& operator=(const FileOrderer& other);
+
+};
+
+#endif // FILEORDERER_H
@@ -0,0 +1,463 @@
+#ifndef FILEREADER_H
+#define FILEREADER_H
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits>
+#include <linux/aio_abi.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+#include "AlignedBufferPool.h"
+
+/**
+ * Settings shared by every FileReader in a run
+ */
+struct FileReaderSettings
+{
+	FileReaderSettings()
+		: dropCache(false),
+		  directBuffers(NULL),
+		  directQueueDepth(4)
+	{ }
+
+	bool dropCache;						// Ask the kernel to drop each file from the page cache once we are done with it
+	AlignedBufferPool *directBuffers;	// Read with O_DIRECT into buffers from this pool, NULL to read through the page cache
+	size_t directQueueDepth;			// The number of O_DIRECT reads to keep in flight per file
+};
+
+/**
+ * The FileReader class reads a file front to back in large blocks, skipping the holes in sparse files.  Buffered reads tell
+ * the kernel about the access pattern as they go; O_DIRECT reads bypass the page cache entirely and keep several reads in flight with Linux native AIO,
+ * falling back to buffered reads when the filesystem refuses O_DIRECT and for the unaligned tail of the file
+ */
+class FileReader
+{
+public:
+	static constexpr size_t DIRECT_ALIGNMENT = 4096;			// Satisfies the O_DIRECT alignment rules of any common block device
+	static constexpr size_t DIRECT_BUFFER_SIZE = 1024 * 1024;	// Size of each O_DIRECT read
+
+	/**
+	 * FileReader constructor
+	 *
+	 * @param filename		The full path/name of the file to read
+	 * @param settings		How to read the file
+	 */
+	FileReader(const std::string &filename, const FileReaderSettings &settings = FileReaderSettings())
+		: mFilename(filename),
+		  mSettings(settings),
+		  mFd(-1),
+		  mDirectFd(-1),
+		  mError(0),
+		  mOffset(0),
+		  mFileSize(0),
+		  mDataEnd(0),
+		  mSparse(false),
+		  mSkippedBytes(0),
+		  mDirectEnd(0),
+		  mContext(0),
+		  mReturnedSlot(-1)
+	{ }
+
+	/**
+	 * FileReader destructor
+	 */
+	~FileReader()
+	{
+		Close();
+	}
+
+	/**
+	 * Open the file for reading
+	 *
+	 * @return	True if the file was opened, false otherwise (see GetError)
+	 */
+	bool Open()
+	{
+		if (mSettings.directBuffers != NULL && OpenDirect())
+			return true;
+		return OpenBuffered();
+	}
+
+	/**
+	 * Read the next block of the file.  Holes in sparse files are skipped rather than read as zeros
+	 *
+	 * @param data		Set to the start of the block; valid until the next call
+	 * @param length	Set to the number of bytes in the block
+	 * @param afterHole	Set to true if a hole was skipped between the previous block and this one
+	 * @return			True if a block was read, false at the end of the file or on error (see GetError)
+	 */
+	bool Next(const char* &data, size_t &length, bool &afterHole)
+	{
+		afterHole = false;
+		if (mContext != 0)
+		{
+			if (NextDirect(data, length))
+				return true;
+			if (mError != 0)
+				return false;
+
+			// The aligned part of the file is done, or the filesystem turned out not to support O_DIRECT
+			FinishDirect();
+			if (mOffset >= mFileSize)
+				return false;
+			if (mFd < 0 && !OpenBuffered())
+				return false;
+		}
+
+		if (mOffset >= mDataEnd && !FindData(afterHole))
+			return false;
+
+		if (mBuffer.empty())
+			mBuffer.resize(READ_BLOCK_SIZE);
+		while (true)
+		{
+			size_t toRead = static_cast<size_t>(std::min(static_cast<off_t>(mBuffer.size()), mDataEnd - mOffset));
+			ssize_t bytesRead = pread(mFd, mBuffer.data(), toRead, mOffset);
+			if (bytesRead < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				mError = errno;
+				return false;
+			}
+			if (bytesRead == 0)
+				return false;
+
+			mOffset += bytesRead;
+			data = mBuffer.data();
+			length = static_cast<size_t>(bytesRead);
+			return true;
+		}
+	}
+
+	/**
+	 * Close the file, dropping it from the page cache if requested
+	 */
+	void Close()
+	{
+		FinishDirect();
+		if (mDirectFd >= 0)
+		{
+			close(mDirectFd);
+			mDirectFd = -1;
+		}
+		if (mFd >= 0)
+		{
+			// Anything read through the page cache in O_DIRECT mode is the unaligned tail, which we don't want cached either
+			if (mSettings.dropCache || mSettings.directBuffers != NULL)
+				posix_fadvise(mFd, 0, 0, POSIX_FADV_DONTNEED);
+			close(mFd);
+			mFd = -1;
+		}
+	}
+
+	/**
+	 * Get the number of bytes in holes that were skipped instead of read
+	 *
+	 * @return	The number of bytes
+	 */
+	uint64_t GetSkippedBytes() const
+	{
+		return mSkippedBytes;
+	}
+
+	/**
+	 * Get the error from the last failed operation
+	 *
+	 * @return	The errno value, or 0 if nothing has failed
+	 */
+	int GetError() const
+	{
+		return mError;
+	}
+
+
+private:
+	static constexpr size_t READ_BLOCK_SIZE = 64 * 1024;  // Large enough to amortize the syscall, small enough to stay in L2
+
+	/**
+	 * An O_DIRECT read, in flight or completed
+	 */
+	struct DirectSlot
+	{
+		char *buffer;
+		off_t offset;
+		bool done;
+		int64_t result;
+		struct iocb request;
+	};
+
+	std::string mFilename;
+	FileReaderSettings mSettings;
+	int mFd;					// Buffered descriptor
+	int mDirectFd;				// O_DIRECT descriptor
+	int mError;
+	off_t mOffset;				// The offset of the next byte to hand out
+	off_t mFileSize;			// The size of the file when it was opened
+	off_t mDataEnd;				// The end of the data extent being read buffered
+	bool mSparse;				// The file has holes, look for them with SEEK_DATA/SEEK_HOLE
+	uint64_t mSkippedBytes;
+	off_t mDirectEnd;			// The end of the part of the file read with O_DIRECT, a multiple of DIRECT_ALIGNMENT
+	aio_context_t mContext;
+	std::vector<DirectSlot> mSlots;
+	std::vector<struct io_event> mEvents;
+	int mReturnedSlot;			// The slot whose buffer was handed out by the last call to Next, -1 if none
+	std::vector<char> mBuffer;
+
+	/**
+	 * Open the file for buffered reads
+	 *
+	 * @return	True if the file was opened
+	 */
+	bool OpenBuffered()
+	{
+		mFd = open(mFilename.c_str(), O_RDONLY);
+		if (mFd < 0)
+		{
+			mError = errno;
+			return false;
+		}
+
+		// We read every file once, front to back, so ask for aggressive readahead
+		if (mSettings.directBuffers == NULL)
+			posix_fadvise(mFd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+		struct stat fileStat;
+		if (fstat(mFd, &fileStat) == 0)
+		{
+			mFileSize = fileStat.st_size;
+			mSparse = IsSparse(fileStat);
+		}
+		return true;
+	}
+
+	/**
+	 * Check if a file has fewer blocks allocated than its size needs, i.e. it has holes
+	 *
+	 * @param fileStat	The stat of the file
+	 * @return			True if the file is sparse
+	 */
+	static bool IsSparse(const struct stat &fileStat)
+	{
+		return static_cast<off_t>(fileStat.st_blocks) * 512 < fileStat.st_size;
+	}
+
+	/**
+	 * Find the next extent of data to read buffered, skipping over any hole at the current offset
+	 *
+	 * @param skippedHole	Set to true if a hole was skipped
+	 * @return				True if there is more data, false at the end of the file
+	 */
+	bool FindData(bool &skippedHole)
+	{
+		if (!mSparse)
+		{
+			// Read until pread reports the end, in case the file grows while we are reading it
+			mDataEnd = std::numeric_limits<off_t>::max();
+			return true;
+		}
+
+		off_t dataStart = lseek(mFd, mOffset, SEEK_DATA);
+		if (dataStart < 0)
+		{
+			if (errno == ENXIO)
+			{
+				// Nothing but hole from here to the end of the file
+				if (mFileSize > mOffset)
+					mSkippedBytes += mFileSize - mOffset;
+				mOffset = std::max(mOffset, mFileSize);
+				return false;
+			}
+
+			// The filesystem doesn't support SEEK_DATA, read the holes as zeros
+			mSparse = false;
+			return FindData(skippedHole);
+		}
+
+		off_t dataEnd = lseek(mFd, dataStart, SEEK_HOLE);
+		if (dataEnd < 0)
+		{
+			mSparse = false;
+			return FindData(skippedHole);
+		}
+
+		if (dataStart > mOffset)
+		{
+			mSkippedBytes += dataStart - mOffset;
+			skippedHole = true;
+		}
+		mOffset = dataStart;
+		mDataEnd = dataEnd;
+		return true;
+	}
+
+	/**
+	 * Open the file with O_DIRECT and start the first reads
+	 *
+	 * @return	True if O_DIRECT reads are under way, false to read the whole file buffered instead
+	 */
+	bool OpenDirect()
+	{
+		mDirectFd = open(mFilename.c_str(), O_RDONLY | O_DIRECT);
+		if (mDirectFd < 0)
+			return false;
+
+		struct stat fileStat;
+		if (fstat(mDirectFd, &fileStat) != 0)
+			return false;
+		mFileSize = fileStat.st_size;
+		mDirectEnd = mFileSize - mFileSize % DIRECT_ALIGNMENT;
+		if (mDirectEnd == 0)
+			return false;
+
+		// Reading holes with O_DIRECT would transfer zeros; sparse files take the buffered path, which skips them
+		if (IsSparse(fileStat))
+			return false;
+
+		size_t depth = std::max<size_t>(1, mSettings.directQueueDepth);
+		if (syscall(__NR_io_setup, depth, &mContext) != 0)
+		{
+			mContext = 0;
+			return false;
+		}
+
+		mSlots.resize(depth);
+		mEvents.resize(depth);
+		for (size_t i = 0; i < depth; ++i)
+		{
+			mSlots[i].buffer = mSettings.directBuffers->Acquire();
+			mSlots[i].done = true;
+			mSlots[i].result = 0;
+			Submit(i, static_cast<off_t>(i * mSettings.directBuffers->GetBufferSize()));
+		}
+		return true;
+	}
+
+	/**
+	 * Start an O_DIRECT read into a slot, if the offset is within the aligned part of the file
+	 *
+	 * @param slot		The index of the slot to use
+	 * @param offset	The offset to read from
+	 */
+	void Submit(const size_t &slot, const off_t &offset)
+	{
+		DirectSlot &directSlot = mSlots[slot];
+		directSlot.offset = offset;
+		if (offset >= mDirectEnd)
+			return;
+
+		memset(&directSlot.request, 0, sizeof(directSlot.request));
+		directSlot.request.aio_data = slot;
+		directSlot.request.aio_lio_opcode = IOCB_CMD_PREAD;
+		directSlot.request.aio_fildes = mDirectFd;
+		directSlot.request.aio_buf = reinterpret_cast<uint64_t>(directSlot.buffer);
+		directSlot.request.aio_nbytes = std::min(static_cast<off_t>(mSettings.directBuffers->GetBufferSize()), mDirectEnd - offset);
+		directSlot.request.aio_offset = offset;
+
+		struct iocb *requests[] = { &directSlot.request };
+		directSlot.done = false;
+		if (syscall(__NR_io_submit, mContext, 1, requests) != 1)
+		{
+			// Treat a failed submission like a failed read; NextDirect falls back to buffered reads
+			directSlot.done = true;
+			directSlot.result = -EINVAL;
+		}
+	}
+
+	/**
+	 * Hand out the next O_DIRECT block, waiting for its read to complete
+	 *
+	 * @param data		Set to the start of the block
+	 * @param length	Set to the number of bytes in the block
+	 * @return			True if a block was read, false when the aligned part of the file is done, on error, or if the
+	 *					read was refused and the rest of the file should be read buffered
+	 */
+	bool NextDirect(const char* &data, size_t &length)
+	{
+		// The caller is done with the previous block, so its buffer can be reused for the next read
+		size_t depth = mSlots.size();
+		off_t stride = static_cast<off_t>(depth * mSettings.directBuffers->GetBufferSize());
+		if (mReturnedSlot >= 0)
+		{
+			Submit(mReturnedSlot, mSlots[mReturnedSlot].offset + stride);
+			mReturnedSlot = -1;
+		}
+
+		if (mOffset >= mDirectEnd)
+			return false;
+
+		size_t slot = static_cast<size_t>((mOffset / static_cast<off_t>(mSettings.directBuffers->GetBufferSize())) % depth);
+		while (!mSlots[slot].done)
+		{
+			long completed = syscall(__NR_io_getevents, mContext, 1, depth, mEvents.data(), NULL);
+			if (completed < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				mError = errno;
+				return false;
+			}
+			for (long i = 0; i < completed; ++i)
+			{
+				mSlots[mEvents[i].data].done = true;
+				mSlots[mEvents[i].data].result = mEvents[i].res;
+			}
+		}
+
+		int64_t result = mSlots[slot].result;
+		if (result == -EINVAL)
+			return false;
+		if (result < 0)
+		{
+			mError = static_cast<int>(-result);
+			return false;
+		}
+		if (result == 0)
+		{
+			// The file shrank while we were reading it
+			mDirectEnd = mOffset;
+			return false;
+		}
+
+		data = mSlots[slot].buffer;
+		length = static_cast<size_t>(result);
+		mOffset += result;
+		mReturnedSlot = static_cast<int>(slot);
+		if (result < static_cast<int64_t>(mSlots[slot].request.aio_nbytes))
+		{
+			// A short read means the file shrank; stop reading it directly and let the buffered path pick up anything after
+			mDirectEnd = mOffset;
+		}
+		return true;
+	}
+
+	/**
+	 * Wait out any O_DIRECT reads still in flight and return their buffers to the pool
+	 */
+	void FinishDirect()
+	{
+		if (mContext == 0)
+			return;
+
+		// io_destroy waits for outstanding requests, so the buffers are safe to reuse afterwards
+		syscall(__NR_io_destroy, mContext);
+		mContext = 0;
+		for (auto &slot : mSlots)
+			mSettings.directBuffers->Release(slot.buffer);
+		mSlots.clear();
+		mReturnedSlot = -1;
+	}
+
+	// No copying
+	FileReader(const FileReader&);
+	FileReader& operator=(const FileReader& other);
+
+};
+
+#endif // FILEREADER_H
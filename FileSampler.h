@@ -0,0 +1,97 @@
+#ifndef FILESAMPLER_H
+#define FILESAMPLER_H
+
+#include <algorithm>
+#include <random>
+#include <stdint.h>
+#include <vector>
+#include "FileEntry.h"
+
+/**
+ * The FileSampler class keeps a uniform random sample of a fixed number of the files found during a search, without
+ * knowing in advance how many files there will be (reservoir sampling).  Not thread-safe
+ */
+class FileSampler
+{
+public:
+
+	/**
+	 * FileSampler constructor
+	 *
+	 * @param sampleSize	The number of files to keep
+	 * @param seed			Seed for the random choices
+	 */
+	FileSampler(const size_t &sampleSize, const uint64_t &seed = std::random_device()())
+		: mSampleSize(sampleSize),
+		  mFilesFound(0),
+		  mBytesFound(0),
+		  mRandom(seed)
+	{
+		mSample.reserve(mSampleSize);
+	}
+
+	/**
+	 * Offer a found file to the sample.  The first sampleSize files are kept; after that the n-th file replaces a random
+	 * member of the sample with probability sampleSize / n, so every file found is equally likely to end up in it
+	 *
+	 * @param file	The found file
+	 */
+	void AddFile(const FileEntry &file)
+	{
+		mFilesFound++;
+		mBytesFound += file.size;
+		if (mSample.size() < mSampleSize)
+		{
+			mSample.push_back(file);
+			return;
+		}
+
+		uint64_t slot = std::uniform_int_distribution<uint64_t>(0, mFilesFound - 1)(mRandom);
+		if (slot < mSampleSize)
+			mSample[slot] = file;
+	}
+
+	/**
+	 * Hand over the sample in random order, so that any prefix of it is also a uniform sample
+	 *
+	 * @return	The sampled files
+	 */
+	std::vector<FileEntry> TakeSample()
+	{
+		std::shuffle(mSample.begin(), mSample.end(), mRandom);
+		std::vector<FileEntry> sample;
+		sample.swap(mSample);
+		return sample;
+	}
+
+	/**
+	 * Get the number of files offered to the sample
+	 */
+	uint64_t GetFilesFound() const
+	{
+		return mFilesFound;
+	}
+
+	/**
+	 * Get the total size of the files offered to the sample
+	 */
+	uint64_t GetBytesFound() const
+	{
+		return mBytesFound;
+	}
+
+
+private:
+	size_t mSampleSize;
+	uint64_t mFilesFound;
+	uint64_t mBytesFound;
+	std::mt19937_64 mRandom;
+	std::vector<FileEntry> mSample;
+
+	// No copying
+	FileSampler(const FileSampler&);
+	FileSampler& operator=(const FileSampler& other);
+
+};
+
+#endif // FILESAMPLER_H
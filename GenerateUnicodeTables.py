@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+"""
+Generate UnicodeTables.h, the character classes and case folding used by Tokenizer.h, from the Unicode database
+bundled with Python.  Run it again after a Python upgrade to pick up a newer Unicode version:
+
+    python3 GenerateUnicodeTables.py > UnicodeTables.h
+"""
+
+import sys
+import unicodedata
+
+# Letters, decimal digits and the combining marks that attach to them, so decomposed accented letters stay whole
+WORD_CATEGORIES = {'Lu', 'Ll', 'Lt', 'Lm', 'Lo', 'Nd', 'Mn', 'Mc'}
+FIRST_NON_ASCII = 0x80
+LAST_CODE_POINT = 0x10FFFF
+
+
+def category_ranges(categories):
+    ranges = []
+    for codePoint in range(FIRST_NON_ASCII, LAST_CODE_POINT + 1):
+        if unicodedata.category(chr(codePoint)) not in categories:
+            continue
+        if ranges and ranges[-1][1] == codePoint - 1:
+            ranges[-1][1] = codePoint
+        else:
+            ranges.append([codePoint, codePoint])
+    return ranges
+
+
+def fold_ranges():
+    # Simple (one to one) lowercase mappings, grouped into runs that share a delta and a stride between entries; stride 2
+    # covers the alternating upper/lower pairs that most European scripts use
+    mappings = []
+    for codePoint in range(FIRST_NON_ASCII, LAST_CODE_POINT + 1):
+        lower = chr(codePoint).lower()
+        if len(lower) == 1 and ord(lower) != codePoint:
+            mappings.append((codePoint, ord(lower) - codePoint))
+
+    ranges = []
+    for codePoint, delta in mappings:
+        if ranges:
+            last = ranges[-1]
+            if last[2] == delta and last[1] + last[3] == codePoint:
+                last[1] = codePoint
+                continue
+            if last[2] == delta and last[0] == last[1] and codePoint - last[1] == 2:
+                last[1] = codePoint
+                last[3] = 2
+                continue
+        ranges.append([codePoint, codePoint, delta, 1])
+    return ranges
+
+
+def main():
+    out = sys.stdout
+    out.write('#ifndef UNICODETABLES_H\n#define UNICODETABLES_H\n\n#include <stddef.h>\n#include <stdint.h>\n\n')
+    out.write('// Generated by GenerateUnicodeTables.py from Unicode %s; do not edit\n\n' % unicodedata.unidata_version)
+
+    ranges = category_ranges(WORD_CATEGORIES)
+    out.write('// Non-ASCII code points that are part of words (letters, digits and combining marks), as sorted inclusive ranges\n')
+    out.write('static const uint32_t UNICODE_WORD_RANGES[][2] = {\n')
+    for first, last in ranges:
+        out.write('\t{ 0x%X, 0x%X },\n' % (first, last))
+    out.write('};\n')
+    out.write('static const size_t UNICODE_WORD_RANGE_COUNT = %d;\n\n' % len(ranges))
+
+    ranges = category_ranges({'Nd'})
+    out.write('// Non-ASCII decimal digits (Arabic-Indic, Devanagari, fullwidth and so on), as sorted inclusive ranges\n')
+    out.write('static const uint32_t UNICODE_DIGIT_RANGES[][2] = {\n')
+    for first, last in ranges:
+        out.write('\t{ 0x%X, 0x%X },\n' % (first, last))
+    out.write('};\n')
+    out.write('static const size_t UNICODE_DIGIT_RANGE_COUNT = %d;\n\n' % len(ranges))
+
+    ranges = fold_ranges()
+    out.write('// Non-ASCII simple lowercase mappings as sorted { first, last, delta, stride } runs: every stride-th code point from\n')
+    out.write('// first to last maps to itself plus delta\n')
+    out.write('static const int32_t UNICODE_FOLD_RANGES[][4] = {\n')
+    for first, last, delta, stride in ranges:
+        out.write('\t{ 0x%X, 0x%X, %d, %d },\n' % (first, last, delta, stride))
+    out.write('};\n')
+    out.write('static const size_t UNICODE_FOLD_RANGE_COUNT = %d;\n\n' % len(ranges))
+
+    out.write('#endif // UNICODETABLES_H\n')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,145 @@
+#ifndef HOTWORDCACHE_H
+#define HOTWORDCACHE_H
+
+#include <limits>
+#include <stdint.h>
+#include <string>
+#include "WordAccumulator.h"
+
+/**
+ * The HotWordCache class is a small per-thread cache of word counts in front of a shared WordAccumulator.  Word counts
+ * follow Zipf's law, so a few hundred words make up most of the text; those words are counted here without locking and
+ * their counts handed to the accumulator only when they leave the cache or the cache is flushed.  It is set associative
+ * and sized to stay in the L1 cache, and uses the accumulator's hash so a word that misses is only hashed once.  Eviction goes by
+ * frequency: each cached word has a hit counter, every counter is halved every so often so words that go cold fade, and a
+ * word that misses only takes the place of the least used word in its set if that word's counter has faded to zero.
+ * Otherwise the missing word is passed straight through to the accumulator, so the long tail of rare words doesn't push
+ * out the common ones.  Words passed through and counts evicted go through the thread's WordAccumulator::Batch, so they
+ * reach the accumulator in prefetched batches.  Counts are exact once the cache is flushed.  Not thread-safe; one per thread
+ */
+class HotWordCache
+{
+public:
+
+	/**
+	 * HotWordCache constructor
+	 */
+	HotWordCache()
+		: mUntilAging(AGING_INTERVAL)
+	{ }
+
+	/**
+	 * Count an occurance of a word
+	 *
+	 * @param word			The word
+	 * @param accumulator	Where counts go when they leave the cache
+	 * @param batch			The thread's batch for the accumulator, which words passed through or evicted are queued on
+	 */
+	void AddWord(const std::string &word, WordAccumulator &accumulator, WordAccumulator::Batch &batch)
+	{
+		if (--mUntilAging == 0)
+			Age();
+
+		size_t hash = accumulator.Hash(word);
+		Set &set = mSets[hash & (SET_COUNT - 1)];
+		for (size_t way = 0; way < WAYS; ++way)
+		{
+			if (set.hashes[way] == hash && set.words[way] == word)
+			{
+				if (set.hits[way] < MAX_HITS)
+					set.hits[way]++;
+				if (++set.counts[way] == MAX_PENDING)
+					FlushWay(set, way, accumulator, batch);
+				return;
+			}
+		}
+
+		size_t victim = 0;
+		for (size_t way = 1; way < WAYS; ++way)
+		{
+			if (set.hits[way] < set.hits[victim])
+				victim = way;
+		}
+		if (set.hits[victim] > 0)
+		{
+			batch.AddWord(word, 1, hash, accumulator);
+			return;
+		}
+
+		FlushWay(set, victim, accumulator, batch);
+		set.words[victim] = word;
+		set.hashes[victim] = hash;
+		set.counts[victim] = 1;
+		set.hits[victim] = 1;
+	}
+
+	/**
+	 * Hand every count held in the cache to the accumulator, along with the rest of the batch.  The words stay cached
+	 *
+	 * @param accumulator	Where the counts go
+	 * @param batch			The thread's batch for the accumulator
+	 */
+	void Flush(WordAccumulator &accumulator, WordAccumulator::Batch &batch)
+	{
+		for (auto &set : mSets)
+		{
+			for (size_t way = 0; way < WAYS; ++way)
+				FlushWay(set, way, accumulator, batch);
+		}
+		batch.Flush(accumulator);
+	}
+
+
+private:
+	static constexpr size_t SET_COUNT = 64;			// Must be a power of two
+	static constexpr size_t WAYS = 4;
+	static constexpr uint32_t MAX_HITS = 0xFFFF;
+	static constexpr size_t AGING_INTERVAL = 4096;	// Words counted between halvings of the hit counters
+	static constexpr int MAX_PENDING = std::numeric_limits<int>::max();
+
+	// The ways of a set are laid out side by side so a lookup compares all of the hashes before touching any words
+	struct Set
+	{
+		Set()
+			: hashes(),
+			  counts(),
+			  hits()
+		{ }
+
+		size_t hashes[WAYS];
+		int counts[WAYS];		// Occurances not yet handed to the accumulator
+		uint32_t hits[WAYS];	// Recent use, for eviction
+		std::string words[WAYS];
+	};
+
+	Set mSets[SET_COUNT];
+	size_t mUntilAging;
+
+	/**
+	 * Halve every hit counter
+	 */
+	void Age()
+	{
+		mUntilAging = AGING_INTERVAL;
+		for (auto &set : mSets)
+		{
+			for (auto &hits : set.hits)
+				hits >>= 1;
+		}
+	}
+
+	void FlushWay(Set &set, const size_t &way, WordAccumulator &accumulator, WordAccumulator::Batch &batch)
+	{
+		if (set.counts[way] == 0)
+			return;
+		batch.AddWord(set.words[way], set.counts[way], set.hashes[way], accumulator);
+		set.counts[way] = 0;
+	}
+
+	// No copying
+	HotWordCache(const HotWordCache&);
+	HotWordCache& operator=(const HotWordCache& other);
+
+};
+
+#endif // HOTWORDCACHE_H
@@ -0,0 +1,80 @@
+#ifndef HUGEPAGES_H
+#define HUGEPAGES_H
+
+#include <atomic>
+#include <errno.h>
+#include <iostream>
+#include <new>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+
+/**
+ * The pages to back large word tables with
+ */
+enum class HugePageMode
+{
+	Off,			// Ordinary pages
+	Transparent,	// Ask for transparent huge pages with madvise
+	Explicit		// Reserved huge pages (MAP_HUGETLB), falling back to transparent ones if none are free
+};
+
+constexpr size_t HUGE_PAGE_SIZE = 2 << 20;
+
+/**
+ * Map zeroed memory for a table.  With huge pages the size is rounded up to whole huge pages and the mapping is aligned
+ * to one, so every page of it can be a huge page.  Throws std::bad_alloc if there is no memory
+ *
+ * @param bytes	The size wanted; set to the size mapped, to pass to UnmapPages
+ * @param mode	The pages to use
+ * @return		The memory
+ */
+inline void* MapPages(size_t &bytes, const HugePageMode &mode)
+{
+	if (mode == HugePageMode::Off)
+	{
+		void *memory = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (memory == MAP_FAILED)
+			throw std::bad_alloc();
+		return memory;
+	}
+
+	bytes = (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+	if (mode == HugePageMode::Explicit)
+	{
+		void *memory = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (memory != MAP_FAILED)
+			return memory;
+
+		// Say so once, rather than for every table
+		static std::atomic<bool> warned(false);
+		int err = errno;
+		if (!warned.exchange(true))
+			std::cout << "Failed to map reserved huge pages, using transparent huge pages: [" << err << "] " << strerror(err) << std::endl;
+	}
+
+	// Map a huge page more than needed and trim the ends so the mapping starts on a huge page boundary
+	size_t padded = bytes + HUGE_PAGE_SIZE;
+	char *memory = static_cast<char*>(mmap(NULL, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+	if (memory == MAP_FAILED)
+		throw std::bad_alloc();
+	char *aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(memory) + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1));
+	if (aligned > memory)
+		munmap(memory, aligned - memory);
+	munmap(aligned + bytes, memory + padded - (aligned + bytes));
+	madvise(aligned, bytes, MADV_HUGEPAGE);
+	return aligned;
+}
+
+/**
+ * Unmap memory from MapPages
+ *
+ * @param memory	The memory
+ * @param bytes		The size MapPages set
+ */
+inline void UnmapPages(void *memory, const size_t &bytes)
+{
+	munmap(memory, bytes);
+}
+
+#endif // HUGEPAGES_H
@@ -0,0 +1,363 @@
+#ifndef LOCKFREEWORDMAP_H
+#define LOCKFREEWORDMAP_H
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "HugePages.h"
+
+/**
+ * The LockFreeWordMap class is a concurrent hash map from words to counts that never takes a lock.  Each word lives in
+ * an immutable record that holds its count in an atomic, and the table's slots point at the records, so counting a word
+ * that is already there is a probe and a fetch-add.  A new word is published by a compare-and-swap on an empty slot.
+ *
+ * When a table fills past half it is replaced by one twice the size, without stopping the world: any thread that runs
+ * into the move helps copy a chunk of slots across.  Copying only moves pointers, so counts added through the old table
+ * during the move still land in the same record.  A copied slot that was empty is marked as moved, so a word missing from
+ * the old table is added to the new one instead; slots that hold a word never change, which is what keeps a word from
+ * being added to both.  Old tables are kept until the map is cleared, since threads may still be reading them.
+ * Thread-safe, apart from Clear
+ */
+class LockFreeWordMap
+{
+public:
+
+	/**
+	 * LockFreeWordMap constructor
+	 *
+	 * @param hugePages	The pages to keep the tables in
+	 */
+	LockFreeWordMap(const HugePageMode &hugePages = HugePageMode::Off)
+		: mHugePages(hugePages),
+		  mFirst(new Table(INITIAL_CAPACITY, mHugePages)),
+		  mCurrent(mFirst)
+	{ }
+
+	/**
+	 * LockFreeWordMap destructor
+	 */
+	~LockFreeWordMap()
+	{
+		DeleteAll();
+	}
+
+	/**
+	 * Add several occurances of a word
+	 *
+	 * @param word	The word
+	 * @param count	The number of occurances
+	 * @param hash	The word's hash
+	 */
+	void AddWord(const std::string &word, const int &count, const size_t &hash)
+	{
+		Table *table = mCurrent.load(std::memory_order_acquire);
+		Key *fresh = NULL;
+		while (true)
+		{
+			StartMove(table);
+			size_t mask = table->mask;
+			size_t i = hash & mask;
+			for (size_t probes = 0; probes <= mask; ++probes, i = (i + 1) & mask)
+			{
+				Key *key = table->slots[i].load(std::memory_order_acquire);
+				if (key == NULL)
+				{
+					if (fresh == NULL)
+						fresh = new Key(word, hash, count);
+					if (table->slots[i].compare_exchange_strong(key, fresh, std::memory_order_acq_rel))
+					{
+						Added(table);
+						return;
+					}
+				}
+				if (key == Moved())
+					break;
+				if (key->hash == hash && key->word == word)
+				{
+					key->count.fetch_add(count, std::memory_order_relaxed);
+					delete fresh;
+					return;
+				}
+			}
+
+			// The word isn't in this table and can't be added to it
+			table = NextTable(table);
+		}
+	}
+
+	/**
+	 * Start loading the slot a word's lookup begins at into the CPU cache
+	 *
+	 * @param hash	The word's hash
+	 */
+	void Prefetch(const size_t &hash) const
+	{
+		Table *table = mCurrent.load(std::memory_order_acquire);
+		__builtin_prefetch(&table->slots[hash & table->mask]);
+	}
+
+	/**
+	 * Get every word and its count.  Can run alongside AddWord; counts added meanwhile may or may not be included
+	 *
+	 * @return	Every word with its count, in no particular order
+	 */
+	std::vector<std::pair<std::string, int> > ListAllWords()
+	{
+		Table *table = SettledTable();
+		std::vector<std::pair<std::string, int> > allWords;
+		allWords.reserve(table->used.load(std::memory_order_relaxed));
+		for (size_t i = 0; i <= table->mask; ++i)
+		{
+			Key *key = table->slots[i].load(std::memory_order_acquire);
+			if (key != NULL && key != Moved())
+				allWords.emplace_back(key->word, key->count.load(std::memory_order_relaxed));
+		}
+		return allWords;
+	}
+
+	/**
+	 * Get the number of unique words
+	 */
+	size_t GetUniqueWordCount()
+	{
+		return SettledTable()->used.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * Remove all words.  Not thread-safe
+	 */
+	void Clear()
+	{
+		DeleteAll();
+		mFirst = new Table(INITIAL_CAPACITY, mHugePages);
+		mCurrent.store(mFirst);
+	}
+
+
+private:
+	static constexpr size_t INITIAL_CAPACITY = 4096;	// Must be a power of two
+	static constexpr size_t COPY_CHUNK = 1024;			// Slots claimed at a time when copying to a bigger table
+
+	/**
+	 * A word and its count.  Everything but the count is fixed once it is published
+	 */
+	struct Key
+	{
+		Key(const std::string &word, const size_t &hash, const int &count)
+			: hash(hash),
+			  count(count),
+			  word(word)
+		{ }
+
+		const size_t hash;
+		std::atomic<int> count;
+		const std::string word;
+	};
+
+	struct Table
+	{
+		Table(const size_t &capacity, const HugePageMode &hugePages)
+			: mask(capacity - 1),
+			  mappedBytes(capacity * sizeof(std::atomic<Key*>)),
+			  slots(static_cast<std::atomic<Key*>*>(MapPages(mappedBytes, hugePages))),
+			  used(0),
+			  next(NULL),
+			  copyClaimed(0),
+			  copyDone(0)
+		{
+			for (size_t i = 0; i < capacity; ++i)
+				new (&slots[i]) std::atomic<Key*>(NULL);
+		}
+
+		~Table()
+		{
+			UnmapPages(slots, mappedBytes);
+		}
+
+		const size_t mask;
+		size_t mappedBytes;
+		std::atomic<Key*> *slots;					// NULL for empty, Moved() for empty and copied, otherwise the word
+		std::atomic<size_t> used;					// Words added or copied in
+		std::atomic<Table*> next;					// The bigger table replacing this one, NULL if not full yet
+		std::atomic<size_t> copyClaimed;			// The first slot no thread has started copying
+		std::atomic<size_t> copyDone;				// The number of slots copied
+	};
+
+	HugePageMode mHugePages;
+	Table *mFirst;					// Every table ever used is reachable from here through next
+	std::atomic<Table*> mCurrent;	// The newest table that is completely filled in
+
+	static Key* Moved()
+	{
+		return reinterpret_cast<Key*>(static_cast<uintptr_t>(1));
+	}
+
+	/**
+	 * Count a word added to a table, and start moving to a bigger table if it is over half full
+	 */
+	void Added(Table *table)
+	{
+		size_t used = table->used.fetch_add(1, std::memory_order_relaxed) + 1;
+		if (used * 2 > table->mask + 1 && table->next.load(std::memory_order_acquire) == NULL)
+		{
+			Table *bigger = new Table((table->mask + 1) * 2, mHugePages);
+			Table *expected = NULL;
+			if (!table->next.compare_exchange_strong(expected, bigger, std::memory_order_acq_rel))
+				delete bigger;
+		}
+	}
+
+	/**
+	 * Help copy a table into its replacement if it has one and the copy isn't under way yet, so the move starts as soon
+	 * as the table is half full rather than when it has no free slots left.  Words in it are still found, or marked as
+	 * moved, by the probe that follows
+	 */
+	void StartMove(Table *table)
+	{
+		Table *next = table->next.load(std::memory_order_acquire);
+		if (next != NULL && table->copyClaimed.load(std::memory_order_relaxed) <= table->mask)
+			HelpCopy(table, next);
+	}
+
+	/**
+	 * Get the table after a full one, helping copy words into it along the way
+	 */
+	Table* NextTable(Table *table)
+	{
+		Table *next = table->next.load(std::memory_order_acquire);
+		if (next == NULL)
+		{
+			// Full without having been grown, which only happens when many threads add words at once
+			Table *bigger = new Table((table->mask + 1) * 2, mHugePages);
+			if (!table->next.compare_exchange_strong(next, bigger, std::memory_order_acq_rel))
+				delete bigger;
+			else
+				next = bigger;
+		}
+		HelpCopy(table, next);
+		return next;
+	}
+
+	/**
+	 * Copy unclaimed chunks of a table into its replacement until every chunk has been claimed.  The thread that
+	 * finishes the last chunk moves the current table forward
+	 */
+	void HelpCopy(Table *table, Table *next)
+	{
+		size_t capacity = table->mask + 1;
+		while (true)
+		{
+			size_t begin = table->copyClaimed.fetch_add(COPY_CHUNK, std::memory_order_relaxed);
+			if (begin >= capacity)
+				return;
+			size_t end = std::min(begin + COPY_CHUNK, capacity);
+			for (size_t i = begin; i < end; ++i)
+			{
+				Key *key = table->slots[i].load(std::memory_order_acquire);
+				while (key == NULL && !table->slots[i].compare_exchange_weak(key, Moved(), std::memory_order_acq_rel))
+				{ }
+				if (key != NULL && key != Moved())
+					CopyKey(next, key);
+			}
+			// Sequentially consistent, with the loads in AdvanceCurrent, so that of two threads finishing copies of
+			// neighbouring tables at once, at least one sees both finished
+			if (table->copyDone.fetch_add(end - begin) + (end - begin) == capacity)
+				AdvanceCurrent();
+		}
+	}
+
+	/**
+	 * Move the current table past every table that has been copied out.  Copies can finish out of order, a table's
+	 * replacement being copied onward before the table itself is, so this walks from whatever is current rather than
+	 * from the table just copied; a table is only passed once everything before it is in its replacement
+	 */
+	void AdvanceCurrent()
+	{
+		Table *current = mCurrent.load();
+		Table *next;
+		while ((next = current->next.load(std::memory_order_acquire)) != NULL && current->copyDone.load() == current->mask + 1)
+		{
+			if (mCurrent.compare_exchange_weak(current, next))
+				current = next;
+		}
+	}
+
+	/**
+	 * Add an existing word record to a table, or to its replacement if it is full in turn
+	 */
+	void CopyKey(Table *table, Key *key)
+	{
+		while (true)
+		{
+			StartMove(table);
+			size_t mask = table->mask;
+			size_t i = key->hash & mask;
+			for (size_t probes = 0; probes <= mask; ++probes, i = (i + 1) & mask)
+			{
+				Key *existing = table->slots[i].load(std::memory_order_acquire);
+				if (existing == NULL)
+				{
+					if (table->slots[i].compare_exchange_strong(existing, key, std::memory_order_acq_rel))
+					{
+						Added(table);
+						return;
+					}
+				}
+				if (existing == Moved())
+					break;
+				if (existing == key)
+					return;
+			}
+			table = NextTable(table);
+		}
+	}
+
+	/**
+	 * Get the newest table once every word has been copied into it
+	 */
+	Table* SettledTable()
+	{
+		Table *table = mCurrent.load(std::memory_order_acquire);
+		Table *next;
+		while ((next = table->next.load(std::memory_order_acquire)) != NULL)
+		{
+			HelpCopy(table, next);
+			while (table->copyDone.load(std::memory_order_acquire) < table->mask + 1)
+				std::this_thread::yield();
+			table = next;
+		}
+		return table;
+	}
+
+	/**
+	 * Free every table and word record.  Every record is in the last table
+	 */
+	void DeleteAll()
+	{
+		Table *last = SettledTable();
+		for (size_t i = 0; i <= last->mask; ++i)
+		{
+			Key *key = last->slots[i].load(std::memory_order_relaxed);
+			if (key != NULL && key != Moved())
+				delete key;
+		}
+		for (Table *table = mFirst; table != NULL; )
+		{
+			Table *next = table->next.load(std::memory_order_relaxed);
+			delete table;
+			table = next;
+		}
+	}
+
+	// No copying
+	LockFreeWordMap(const LockFreeWordMap&);
+	LockFreeWordMap& operator=(const LockFreeWordMap& other);
+
+};
+
+#endif // LOCKFREEWORDMAP_H
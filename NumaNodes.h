@@ -0,0 +1,73 @@
+#ifndef NUMANODES_H
+#define NUMANODES_H
+
+#include <fstream>
+#include <sstream>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+/**
+ * Parse a Linux CPU or node list, such as "0-3,8-11"
+ *
+ * @param list	The list
+ * @return		Every number in the list, in order; empty if the list is malformed
+ */
+inline std::vector<int> ParseCpuList(const std::string &list)
+{
+	// The kernel's lists never come near this many CPUs, so a bigger range means the text is garbled
+	static constexpr long MAX_NUMBER = 1 << 16;
+
+	std::vector<int> numbers;
+	std::stringstream ranges(list);
+	std::string range;
+	while (std::getline(ranges, range, ','))
+	{
+		if (range.empty() || range == "\n")
+			continue;
+		const char *text = range.c_str();
+		char *end;
+		long first = strtol(text, &end, 10);
+		long last = first;
+		bool valid = (end != text && first >= 0);
+		if (valid && *end == '-')
+		{
+			text = end + 1;
+			last = strtol(text, &end, 10);
+			valid = (end != text && last >= first);
+		}
+		if (!valid || last > MAX_NUMBER || (*end != '\0' && *end != '\n'))
+			return std::vector<int>();
+		for (long number = first; number <= last; ++number)
+			numbers.push_back(static_cast<int>(number));
+	}
+	return numbers;
+}
+
+/**
+ * Find the online NUMA nodes that have CPUs, and the CPUs in each, from sysfs
+ *
+ * @return	The CPUs of each node, empty if the system doesn't say
+ */
+inline std::vector<std::vector<int> > ReadNumaNodes()
+{
+	std::vector<std::vector<int> > nodes;
+	std::ifstream online("/sys/devices/system/node/online");
+	std::string list;
+	if (!std::getline(online, list))
+		return nodes;
+
+	for (int node : ParseCpuList(list))
+	{
+		std::ifstream cpus("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+		std::string cpuList;
+		if (!std::getline(cpus, cpuList))
+			continue;
+		std::vector<int> cpuNumbers = ParseCpuList(cpuList);
+		if (!cpuNumbers.empty())
+			nodes.push_back(cpuNumbers);
+	}
+	return nodes;
+}
+
+#endif // NUMANODES_H
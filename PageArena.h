@@ -0,0 +1,127 @@
+#ifndef PAGEARENA_H
+#define PAGEARENA_H
+
+#include <boost/thread/mutex.hpp>
+#include <stddef.h>
+#include <utility>
+#include <vector>
+#include "HugePages.h"
+
+/**
+ * The PageArena class hands out blocks of memory with power of two sizes from large mappings, so thousands of small
+ * tables can share huge pages instead of each sitting on ordinary pages of the heap.  Freed blocks are kept by size for
+ * reuse, and everything is returned to the system at once when the arena is reset.  The memory isn't touched until it
+ * is used, so it ends up on the NUMA node of the thread that first writes it.  Thread-safe, apart from Reset
+ */
+class PageArena
+{
+public:
+
+	/**
+	 * PageArena constructor
+	 *
+	 * @param mode	The pages to map
+	 */
+	PageArena(const HugePageMode &mode = HugePageMode::Off)
+		: mMode(mode),
+		  mNext(NULL),
+		  mEnd(NULL)
+	{ }
+
+	/**
+	 * PageArena destructor.  Frees every block
+	 */
+	~PageArena()
+	{
+		Reset();
+	}
+
+	/**
+	 * Get a block of memory.  It may have been used before
+	 *
+	 * @param bytes	The size of the block, a power of two
+	 * @return		The block
+	 */
+	void* Allocate(const size_t &bytes)
+	{
+		size_t sizeClass = SizeClass(bytes);
+		boost::mutex::scoped_lock lock(mMutex);
+		if (sizeClass < mFreeBlocks.size() && !mFreeBlocks[sizeClass].empty())
+		{
+			char *block = mFreeBlocks[sizeClass].back();
+			mFreeBlocks[sizeClass].pop_back();
+			return block;
+		}
+
+		// Blocks too big to share a chunk get a mapping of their own
+		if (bytes > CHUNK_SIZE / 4)
+			return Map(bytes);
+
+		if (mNext == NULL || static_cast<size_t>(mEnd - mNext) < bytes)
+		{
+			mNext = static_cast<char*>(Map(CHUNK_SIZE));
+			mEnd = mNext + CHUNK_SIZE;
+		}
+		char *block = mNext;
+		mNext += bytes;
+		return block;
+	}
+
+	/**
+	 * Return a block for reuse
+	 *
+	 * @param block	A block from Allocate
+	 * @param bytes	The size it was allocated with
+	 */
+	void Free(void *block, const size_t &bytes)
+	{
+		size_t sizeClass = SizeClass(bytes);
+		boost::mutex::scoped_lock lock(mMutex);
+		if (mFreeBlocks.size() <= sizeClass)
+			mFreeBlocks.resize(sizeClass + 1);
+		mFreeBlocks[sizeClass].push_back(static_cast<char*>(block));
+	}
+
+	/**
+	 * Free every block at once.  Not thread-safe
+	 */
+	void Reset()
+	{
+		for (auto &mapping : mMappings)
+			UnmapPages(mapping.first, mapping.second);
+		mMappings.clear();
+		mFreeBlocks.clear();
+		mNext = NULL;
+		mEnd = NULL;
+	}
+
+
+private:
+	static constexpr size_t CHUNK_SIZE = 4 * HUGE_PAGE_SIZE;
+
+	HugePageMode mMode;
+	boost::mutex mMutex;
+	std::vector<std::pair<void*, size_t> > mMappings;	// Everything mapped, guarded by mMutex
+	std::vector<std::vector<char*> > mFreeBlocks;		// Freed blocks by size class, guarded by mMutex
+	char *mNext;										// The unused part of the newest chunk, guarded by mMutex
+	char *mEnd;
+
+	static size_t SizeClass(const size_t &bytes)
+	{
+		return __builtin_ctzll(bytes);
+	}
+
+	void* Map(size_t bytes)
+	{
+		void *memory = MapPages(bytes, mMode);
+		mMappings.emplace_back(memory, bytes);
+		return memory;
+	}
+
+	// No copying
+	PageArena(const PageArena&);
+	PageArena& operator=(const PageArena& other);
+
+};
+
+#endif // PAGEARENA_H
@@ -0,0 +1,127 @@
+#ifndef PAGECACHEPROBE_H
+#define PAGECACHEPROBE_H
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * The PageCacheProbe class cheaply checks whether a file is already in the page cache, without causing any disk I/O.
+ * Not thread-safe; each thread that probes needs its own instance
+ */
+class PageCacheProbe
+{
+public:
+
+	/**
+	 * PageCacheProbe constructor
+	 */
+	PageCacheProbe()
+		: mBuffer(WINDOW_SIZE),
+		  mUseNoWait(true)
+	{ }
+
+	/**
+	 * Check if a file is resident in the page cache.  Only a window at the start, middle and end of the file is
+	 * checked, so a partially cached file may be reported either way
+	 *
+	 * @param filename	The full path/name of the file to check
+	 * @return			True if the file looks cached, false if reading it would have to go to disk.  Files that
+	 *					cannot be opened are reported as cached, so they fail fast on a processing thread
+	 */
+	bool IsCached(const std::string &filename)
+	{
+		int fd = open(filename.c_str(), O_RDONLY);
+		if (fd < 0)
+			return true;
+
+		struct stat fileStat;
+		bool cached = true;
+		if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0)
+		{
+			off_t size = fileStat.st_size;
+			off_t window = std::min(size, static_cast<off_t>(WINDOW_SIZE));
+			off_t offsets[] = { 0, (size - window) / 2, size - window };
+			for (off_t offset : offsets)
+			{
+				if (!IsRangeCached(fd, offset, static_cast<size_t>(window)))
+				{
+					cached = false;
+					break;
+				}
+			}
+		}
+		close(fd);
+		return cached;
+	}
+
+
+private:
+	static constexpr size_t WINDOW_SIZE = 16 * 1024;
+	std::vector<char> mBuffer;
+	bool mUseNoWait;
+
+	/**
+	 * Check if a range of an open file is resident in the page cache
+	 *
+	 * @param fd		The open file
+	 * @param offset	The start of the range
+	 * @param length	The size of the range, at most WINDOW_SIZE
+	 * @return			True if every page in the range is cached
+	 */
+	bool IsRangeCached(const int &fd, const off_t &offset, const size_t &length)
+	{
+#ifdef RWF_NOWAIT
+		// A non-blocking read only succeeds in full when every page is already cached
+		if (mUseNoWait)
+		{
+			struct iovec vector = { mBuffer.data(), length };
+			ssize_t bytesRead = preadv2(fd, &vector, 1, offset, RWF_NOWAIT);
+			if (bytesRead >= 0)
+				return static_cast<size_t>(bytesRead) == length;
+			if (errno == EAGAIN)
+				return false;
+
+			// The kernel or filesystem doesn't support RWF_NOWAIT, use mincore from now on
+			mUseNoWait = false;
+		}
+#endif
+
+		// Map the range and ask which of its pages are resident
+		static const long pageSize = sysconf(_SC_PAGESIZE);
+		off_t mapOffset = offset - offset % pageSize;
+		size_t mapLength = length + static_cast<size_t>(offset - mapOffset);
+		void *map = mmap(NULL, mapLength, PROT_READ, MAP_SHARED, fd, mapOffset);
+		if (map == MAP_FAILED)
+			return true;
+
+		std::vector<unsigned char> residency((mapLength + pageSize - 1) / pageSize);
+		bool cached = true;
+		if (mincore(map, mapLength, residency.data()) == 0)
+		{
+			for (unsigned char page : residency)
+			{
+				if ((page & 1) == 0)
+				{
+					cached = false;
+					break;
+				}
+			}
+		}
+		munmap(map, mapLength);
+		return cached;
+	}
+
+	// No copying
+	PageCacheProbe(const PageCacheProbe&);
+	PageCacheProbe& operator=(const PageCacheProbe& other);
+
+};
+
+#endif // PAGECACHEPROBE_H
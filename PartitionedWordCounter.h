@@ -0,0 +1,406 @@
+#ifndef PARTITIONEDWORDCOUNTER_H
+#define PARTITIONEDWORDCOUNTER_H
+
+#include <algorithm>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "WordAccumulator.h"
+
+/**
+ * The PartitionedWordCounter class counts words without sharing anything per word between threads.  The hash space is
+ * split into partitions, each owned by one aggregator thread with a private table.  Threads that find words don't touch
+ * the tables; they append each word and its hash to a batch for its partition, through a Writer of their own, and hand
+ * over whole batches.  Since the partitions are disjoint, the unique count is a sum and the top words are a merge of each
+ * partition's top words.  Thread-safe, with one Writer per thread that adds words
+ */
+class PartitionedWordCounter
+{
+public:
+
+	/**
+	 * One batch of words bound for a partition, stored back to back so a batch is three allocations however many words
+	 * it holds
+	 */
+	struct Batch
+	{
+		std::vector<size_t> hashes;
+		std::vector<uint32_t> ends;		// The end of each word in text
+		std::string text;
+
+		void Clear()
+		{
+			hashes.clear();
+			ends.clear();
+			text.clear();
+		}
+	};
+
+	/**
+	 * The per-thread side of a PartitionedWordCounter: one batch in progress per partition.  Not thread-safe; one per
+	 * thread
+	 */
+	class Writer
+	{
+	public:
+
+		Writer()
+		{ }
+
+		/**
+		 * Count an occurance of a word
+		 *
+		 * @param word		The word
+		 * @param counter	The counter the word goes to
+		 */
+		void AddWord(const std::string &word, PartitionedWordCounter &counter)
+		{
+			if (mBatches.size() != counter.GetPartitionCount())
+				mBatches.resize(counter.GetPartitionCount());
+
+			size_t hash = counter.Hash(word);
+			std::unique_ptr<Batch> &batch = mBatches[counter.PartitionOf(hash)];
+			if (!batch)
+				batch = counter.TakeEmptyBatch();
+			batch->hashes.push_back(hash);
+			batch->text.append(word);
+			batch->ends.push_back(static_cast<uint32_t>(batch->text.size()));
+			if (batch->hashes.size() == BATCH_WORDS)
+				counter.Submit(counter.PartitionOf(hash), batch);
+		}
+
+		/**
+		 * Hand over every batch in progress
+		 *
+		 * @param counter	The counter the words go to
+		 */
+		void Flush(PartitionedWordCounter &counter)
+		{
+			for (size_t partition = 0; partition < mBatches.size(); ++partition)
+			{
+				if (mBatches[partition] && !mBatches[partition]->hashes.empty())
+					counter.Submit(partition, mBatches[partition]);
+			}
+		}
+
+	private:
+		static constexpr size_t BATCH_WORDS = 2048;
+		std::vector<std::unique_ptr<Batch> > mBatches;
+
+		// No copying
+		Writer(const Writer&);
+		Writer& operator=(const Writer& other);
+	};
+
+	/**
+	 * PartitionedWordCounter constructor
+	 *
+	 * @param partitions	The number of partitions, and of aggregator threads
+	 */
+	PartitionedWordCounter(const size_t &partitions)
+		: mPartitions(std::max<size_t>(partitions, 1))
+	{ }
+
+	/**
+	 * PartitionedWordCounter destructor
+	 */
+	~PartitionedWordCounter()
+	{
+		Finish();
+	}
+
+	/**
+	 * Clear the counts and start the aggregator threads
+	 */
+	void Start()
+	{
+		for (auto &partition : mPartitions)
+		{
+			partition.table.Clear();
+			partition.stopping = false;
+		}
+		for (auto &partition : mPartitions)
+		{
+			Partition *owned = &partition;
+			mAggregators.create_thread([this, owned]() { AggregatorThread(owned); });
+		}
+	}
+
+	/**
+	 * Count everything handed over so far and stop the aggregator threads.  Every Writer must have been flushed
+	 */
+	void Finish()
+	{
+		for (auto &partition : mPartitions)
+		{
+			boost::mutex::scoped_lock lock(partition.mutex);
+			partition.stopping = true;
+			partition.ready.notify_all();
+		}
+		mAggregators.join_all();
+	}
+
+	/**
+	 * Get the number of partitions
+	 */
+	size_t GetPartitionCount() const
+	{
+		return mPartitions.size();
+	}
+
+	/**
+	 * Hash a word the way the partitions are chosen
+	 */
+	size_t Hash(const std::string &word) const
+	{
+		return mHasher(word);
+	}
+
+	/**
+	 * Get the top occurring words.  Only valid after Finish
+	 *
+	 * @param count	The number of words to return
+	 * @return		Up to count words, sorted from highest occurance to lowest
+	 */
+	std::vector<WordCountType> ListTopWords(const int &count) const
+	{
+		// The partitions are disjoint, so the overall top words are among each partition's top words
+		std::vector<WordCountType> topWords;
+		for (const auto &partition : mPartitions)
+		{
+			std::vector<WordCountType> partitionTop = partition.table.ListTopWords(count);
+			topWords.insert(topWords.end(), partitionTop.begin(), partitionTop.end());
+		}
+		size_t keep = std::min(static_cast<size_t>(count), topWords.size());
+		std::partial_sort(topWords.begin(),
+						  topWords.begin() + keep,
+						  topWords.end(),
+						  [](const WordCountType& a, const WordCountType& b)
+						  {
+							  return a.second > b.second;
+						  });
+		topWords.resize(keep);
+		return topWords;
+	}
+
+	/**
+	 * Get the number of unique words.  Only valid after Finish
+	 */
+	size_t GetUniqueWordCount() const
+	{
+		size_t total = 0;
+		for (const auto &partition : mPartitions)
+			total += partition.table.GetSize();
+		return total;
+	}
+
+
+private:
+	static constexpr size_t MAX_QUEUED_BATCHES = 64;	// Per partition; writers wait for the aggregator past this
+
+	/**
+	 * An open addressing table from words to counts that keeps each word's hash, so it never hashes a word again
+	 */
+	class Table
+	{
+	public:
+		Table()
+			: mSize(0)
+		{ }
+
+		void Clear()
+		{
+			mSlots.assign(INITIAL_SLOTS, Slot());
+			mSize = 0;
+		}
+
+		void AddWord(const std::string_view &word, const size_t &hash)
+		{
+			size_t mask = mSlots.size() - 1;
+			for (size_t i = hash & mask; ; i = (i + 1) & mask)
+			{
+				Slot &slot = mSlots[i];
+				if (slot.count == 0)
+				{
+					slot.hash = hash;
+					slot.word.assign(word.data(), word.size());
+					slot.count = 1;
+					if (++mSize * 2 > mSlots.size())
+						Grow();
+					return;
+				}
+				if (slot.hash == hash && slot.word == word)
+				{
+					slot.count++;
+					return;
+				}
+			}
+		}
+
+		size_t GetSize() const
+		{
+			return mSize;
+		}
+
+		std::vector<WordCountType> ListTopWords(const int &count) const
+		{
+			std::vector<const Slot*> used;
+			used.reserve(mSize);
+			for (const auto &slot : mSlots)
+			{
+				if (slot.count > 0)
+					used.push_back(&slot);
+			}
+			size_t keep = std::min(static_cast<size_t>(count), used.size());
+			std::partial_sort(used.begin(),
+							  used.begin() + keep,
+							  used.end(),
+							  [](const Slot* a, const Slot* b)
+							  {
+								  return a->count > b->count;
+							  });
+
+			std::vector<WordCountType> topWords;
+			for (size_t i = 0; i < keep; ++i)
+				topWords.emplace_back(used[i]->word, used[i]->count);
+			return topWords;
+		}
+
+	private:
+		static constexpr size_t INITIAL_SLOTS = 1024;	// Must be a power of two
+
+		struct Slot
+		{
+			Slot()
+				: hash(0),
+				  count(0)
+			{ }
+
+			size_t hash;
+			int count;		// 0 for an empty slot
+			std::string word;
+		};
+
+		std::vector<Slot> mSlots;
+		size_t mSize;
+
+		void Grow()
+		{
+			std::vector<Slot> old(mSlots.size() * 2);
+			old.swap(mSlots);
+			size_t mask = mSlots.size() - 1;
+			for (auto &slot : old)
+			{
+				if (slot.count == 0)
+					continue;
+				size_t i = slot.hash & mask;
+				while (mSlots[i].count != 0)
+					i = (i + 1) & mask;
+				mSlots[i].hash = slot.hash;
+				mSlots[i].count = slot.count;
+				mSlots[i].word.swap(slot.word);
+			}
+		}
+	};
+
+	struct Partition
+	{
+		Partition()
+			: stopping(false)
+		{ }
+
+		Table table;								// Only touched by the partition's aggregator thread
+		boost::mutex mutex;
+		boost::condition_variable ready;			// Signalled when a batch is queued, or on stopping
+		boost::condition_variable spaceFree;		// Signalled when a batch is taken off the queue
+		std::deque<std::unique_ptr<Batch> > queue;	// Guarded by mutex
+		bool stopping;								// Guarded by mutex
+	};
+
+	std::vector<Partition> mPartitions;
+	boost::thread_group mAggregators;
+	std::hash<std::string> mHasher;
+	boost::mutex mFreeMutex;
+	std::vector<std::unique_ptr<Batch> > mFreeBatches;	// Guarded by mFreeMutex
+
+	/**
+	 * Choose a partition from the top bits of a hash; the tables index by the bottom bits
+	 */
+	size_t PartitionOf(const size_t &hash) const
+	{
+		return static_cast<size_t>(((static_cast<uint64_t>(hash) >> 32) * mPartitions.size()) >> 32);
+	}
+
+	/**
+	 * Get an empty batch, reusing one the aggregators are done with if there is one
+	 */
+	std::unique_ptr<Batch> TakeEmptyBatch()
+	{
+		boost::mutex::scoped_lock lock(mFreeMutex);
+		if (mFreeBatches.empty())
+			return std::unique_ptr<Batch>(new Batch());
+		std::unique_ptr<Batch> batch(std::move(mFreeBatches.back()));
+		mFreeBatches.pop_back();
+		return batch;
+	}
+
+	/**
+	 * Queue a batch for a partition's aggregator, waiting if it is too far behind
+	 */
+	void Submit(const size_t &partitionIndex, std::unique_ptr<Batch> &batch)
+	{
+		Partition &partition = mPartitions[partitionIndex];
+		boost::mutex::scoped_lock lock(partition.mutex);
+		while (partition.queue.size() >= MAX_QUEUED_BATCHES)
+			partition.spaceFree.wait(lock);
+		partition.queue.push_back(std::move(batch));
+		partition.ready.notify_one();
+	}
+
+	/**
+	 * Count the batches queued for a partition until stopped
+	 */
+	void AggregatorThread(Partition *partition)
+	{
+		while (true)
+		{
+			std::unique_ptr<Batch> batch;
+			{
+				boost::mutex::scoped_lock lock(partition->mutex);
+				while (partition->queue.empty() && !partition->stopping)
+					partition->ready.wait(lock);
+				if (partition->queue.empty())
+					return;
+				batch = std::move(partition->queue.front());
+				partition->queue.pop_front();
+				partition->spaceFree.notify_all();
+			}
+
+			uint32_t begin = 0;
+			for (size_t i = 0; i < batch->hashes.size(); ++i)
+			{
+				partition->table.AddWord(std::string_view(batch->text.data() + begin, batch->ends[i] - begin), batch->hashes[i]);
+				begin = batch->ends[i];
+			}
+
+			batch->Clear();
+			boost::mutex::scoped_lock lock(mFreeMutex);
+			mFreeBatches.push_back(std::move(batch));
+		}
+	}
+
+	// No copying
+	PartitionedWordCounter(const PartitionedWordCounter&);
+	PartitionedWordCounter& operator=(const PartitionedWordCounter& other);
+
+};
+
+#endif // PARTITIONEDWORDCOUNTER_H
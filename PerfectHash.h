@@ -0,0 +1,277 @@
+#ifndef PERFECTHASH_H
+#define PERFECTHASH_H
+
+#include <algorithm>
+#include <fstream>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Mix a word's hash with a seed (MurmurHash3's finalizer), giving a family of independent hashes to try without hashing
+ * the word again
+ */
+constexpr uint64_t PerfectHashMix(const uint64_t &hash, const uint64_t &seed)
+{
+	uint64_t mixed = hash ^ (seed * 0x9E3779B97F4A7C15ULL);
+	mixed ^= mixed >> 33;
+	mixed *= 0xFF51AFD7ED558CCDULL;
+	mixed ^= mixed >> 33;
+	mixed *= 0xC4CEB9FE1A85EC53ULL;
+	mixed ^= mixed >> 33;
+	return mixed;
+}
+
+/**
+ * What came of loading a list of words into a PerfectHash
+ */
+enum class WordListStatus
+{
+	Loaded,
+	Unreadable,		// The file couldn't be read; errno says why
+	Unhashable		// Two of the words have the same hash, so they can't be given slots of their own
+};
+
+/**
+ * Read a list of words separated by whitespace, sorted with duplicates removed so it can be given to PerfectHash::Build
+ *
+ * @param path	The file to read
+ * @param words	Filled with the words
+ * @return		True if the file was read
+ */
+inline bool ReadWordList(const std::string &path, std::vector<std::string> &words)
+{
+	std::ifstream file(path);
+	if (!file)
+		return false;
+
+	words.clear();
+	std::string word;
+	while (file >> word)
+		words.push_back(word);
+	if (file.bad())
+		return false;
+
+	std::sort(words.begin(), words.end());
+	words.erase(std::unique(words.begin(), words.end()), words.end());
+	return true;
+}
+
+/**
+ * The PerfectHash class is a minimal perfect hash over a fixed list of distinct words, built at run time (hash and
+ * displace): each word gets a slot of its own from 0 to one less than the number of words, and a lookup is two table
+ * reads and one string compare.  Words are hashed by the caller, with any hash as long as it's the same one for building
+ * and looking up.  Not thread-safe to build, safe to read from any number of threads
+ */
+class PerfectHash
+{
+public:
+	static constexpr size_t NOT_FOUND = static_cast<size_t>(-1);
+
+	/**
+	 * PerfectHash constructor.  There are no words to start with
+	 */
+	PerfectHash()
+		: mTableSize(0)
+	{ }
+
+	/**
+	 * Build the hash for a list of distinct words.  The words are split into buckets by one hash, then, largest bucket
+	 * first, each bucket is given the first displacement that lands all of its words in free slots.  Filling every last
+	 * slot that way takes quadratic time, so the words are placed in a table a few percent larger than the list and the
+	 * handful that land past the end are moved into the gaps, leaving one slot per word
+	 *
+	 * @param words		The words
+	 * @param hashes	The hash of each word
+	 * @return			True if the hash was built; false if two of the words have the same hash, which no displacement
+	 *					can separate, or the words couldn't be placed after a few tries.  There are no words then
+	 */
+	bool Build(const std::vector<std::string> &words, const std::vector<uint64_t> &hashes)
+	{
+		Clear();
+		if (words.empty())
+			return true;
+
+		std::vector<uint64_t> sortedHashes(hashes);
+		std::sort(sortedHashes.begin(), sortedHashes.end());
+		if (std::adjacent_find(sortedHashes.begin(), sortedHashes.end()) != sortedHashes.end())
+			return false;
+
+		// About two words per bucket keeps the displacement search short.  If a bucket can't be placed, which is very
+		// unlikely, try again with more spare slots
+		size_t bucketCount = (words.size() + 1) / 2;
+		std::vector<uint32_t> wordSlots;
+		mTableSize = words.size() + words.size() / 32 + 1;
+		for (int attempt = 0; !Place(hashes, bucketCount, wordSlots); ++attempt)
+		{
+			if (attempt + 1 == MAX_ATTEMPTS)
+			{
+				Clear();
+				return false;
+			}
+			mTableSize += words.size() / 8 + 1;
+		}
+
+		// Pair the words past the end with the free slots before it
+		size_t wordCount = words.size();
+		std::vector<bool> used(wordCount, false);
+		for (uint32_t slot : wordSlots)
+		{
+			if (slot < wordCount)
+				used[slot] = true;
+		}
+		mRemap.assign(mTableSize - wordCount, 0);
+		size_t freeSlot = 0;
+		mWords.resize(wordCount);
+		for (size_t i = 0; i < wordCount; ++i)
+		{
+			size_t slot = wordSlots[i];
+			if (slot >= wordCount)
+			{
+				while (used[freeSlot])
+					freeSlot++;
+				used[freeSlot] = true;
+				mRemap[slot - wordCount] = freeSlot;
+				slot = freeSlot;
+			}
+			mWords[slot] = words[i];
+		}
+		return true;
+	}
+
+	/**
+	 * Remove all words
+	 */
+	void Clear()
+	{
+		mWords.clear();
+		mBuckets.clear();
+		mRemap.clear();
+		mTableSize = 0;
+	}
+
+	/**
+	 * Find a word's slot
+	 *
+	 * @param word	The word
+	 * @param hash	The word's hash
+	 * @return		The word's slot, or NOT_FOUND if it isn't one of the words
+	 */
+	size_t Find(const std::string_view &word, const uint64_t &hash) const
+	{
+		if (mWords.empty())
+			return NOT_FOUND;
+
+		uint32_t displacement = mBuckets[Reduce(PerfectHashMix(hash, 0), mBuckets.size())];
+		size_t slot = Reduce(PerfectHashMix(hash, displacement), mTableSize);
+		if (slot >= mWords.size())
+			slot = mRemap[slot - mWords.size()];
+		return (mWords[slot] == word ? slot : NOT_FOUND);
+	}
+
+	/**
+	 * Get the number of words, which is also the number of slots
+	 */
+	size_t Size() const
+	{
+		return mWords.size();
+	}
+
+	/**
+	 * Get the word in a slot
+	 */
+	const std::string& Word(const size_t &slot) const
+	{
+		return mWords[slot];
+	}
+
+
+private:
+	static constexpr uint32_t MAX_DISPLACEMENT = 1 << 20;
+	static constexpr int MAX_ATTEMPTS = 8;		// Each with more spare slots than the last
+
+	std::vector<std::string> mWords;	// Each word in its slot
+	std::vector<uint32_t> mBuckets;		// The displacement for each bucket of words
+	size_t mTableSize;					// The number of slots words are placed in, a few more than there are words
+	std::vector<uint32_t> mRemap;		// Where each slot past the end of mWords was moved to
+
+	/**
+	 * Find a displacement for every bucket so no two words share a slot
+	 *
+	 * @param hashes		The hash of each word
+	 * @param bucketCount	The number of buckets to split the words into
+	 * @param wordSlots		Filled with the slot of each word
+	 * @return				True if every bucket was placed
+	 */
+	bool Place(const std::vector<uint64_t> &hashes, const size_t &bucketCount, std::vector<uint32_t> &wordSlots)
+	{
+		std::vector<std::vector<uint32_t> > buckets(bucketCount);
+		for (uint32_t i = 0; i < hashes.size(); ++i)
+			buckets[Reduce(PerfectHashMix(hashes[i], 0), bucketCount)].push_back(i);
+
+		std::vector<uint32_t> order(bucketCount);
+		for (uint32_t i = 0; i < bucketCount; ++i)
+			order[i] = i;
+		std::sort(order.begin(),
+				  order.end(),
+				  [&buckets](const uint32_t &a, const uint32_t &b)
+				  {
+					  return buckets[a].size() > buckets[b].size();
+				  });
+
+		mBuckets.assign(bucketCount, 0);
+		wordSlots.assign(hashes.size(), 0);
+		std::vector<bool> taken(mTableSize, false);
+		std::vector<uint32_t> slots;
+		for (uint32_t bucket : order)
+		{
+			if (buckets[bucket].empty())
+				break;
+
+			bool placed = false;
+			for (uint32_t displacement = 1; displacement < MAX_DISPLACEMENT && !placed; ++displacement)
+			{
+				slots.clear();
+				placed = true;
+				for (uint32_t word : buckets[bucket])
+				{
+					uint32_t slot = Reduce(PerfectHashMix(hashes[word], displacement), mTableSize);
+					if (taken[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end())
+					{
+						placed = false;
+						break;
+					}
+					slots.push_back(slot);
+				}
+				if (placed)
+				{
+					mBuckets[bucket] = displacement;
+					for (size_t i = 0; i < slots.size(); ++i)
+					{
+						taken[slots[i]] = true;
+						wordSlots[buckets[bucket][i]] = slots[i];
+					}
+				}
+			}
+			if (!placed)
+				return false;
+		}
+		return true;
+	}
+
+	/**
+	 * Map a hash onto 0..range-1 with a multiply instead of a divide
+	 */
+	static uint32_t Reduce(const uint64_t &hash, const size_t &range)
+	{
+		return static_cast<uint32_t>((static_cast<uint64_t>(static_cast<uint32_t>(hash)) * range) >> 32);
+	}
+
+	// No copying
+	PerfectHash(const PerfectHash&);
+	PerfectHash& operator=(const PerfectHash& other);
+
+};
+
+#endif // PERFECTHASH_H
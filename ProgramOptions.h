@@ -37,6 +37,120 @@ public:
 	        ("threads,t", 
 	                boost::program_options::value<int>()->default_value(3)->required(), 
 	                "the number of file processor threads to use")
+	        ("aggregators", 
+	                boost::program_options::value<int>()->default_value(0), 
+	                "the number of threads that each own a partition of the word counts, fed in batches by the file processor threads; 0 to count in shared bins with locks")
+	        ("word-store", 
+	                boost::program_options::value<std::string>()->default_value("bins"), 
+	                "how the shared word counts are kept: bins (hash tables that grow with the words in them, each behind a lock) or lock-free (one hash map updated with atomic operations)")
+	        ("vocabulary", 
+	                boost::program_options::value<std::string>(), 
+	                "a file of known words, separated by whitespace, to count in fixed slots ahead of the shared word counts")
+	        ("huge-pages", 
+	                boost::program_options::value<std::string>()->default_value("off"), 
+	                "the pages to keep the word tables in: off, transparent (madvise), or explicit (reserved huge pages, falling back to transparent)")
+	        ("numa", 
+	                boost::program_options::bool_switch()->default_value(false), 
+	                "pin the file processor threads to NUMA nodes, round robin, and count words per node, merging the counts at the end")
+	        ("dictionary", 
+	                boost::program_options::bool_switch()->default_value(false), 
+	                "number each unique word once in a shared dictionary and count by number in per-thread arrays, added together at the end")
+	        ("tokenizer", 
+	                boost::program_options::value<std::string>()->default_value("unicode"), 
+	                "how to split text into words: unicode (letters and digits, lowercased), ascii (ASCII letters and digits only), code (underscores join words), hyphen (hyphens join words), or case-sensitive")
+	        ("stop-words", 
+	                boost::program_options::value<std::string>(), 
+	                "leave common words out of the counts: english for the built-in list, or a file of words separated by whitespace")
+	        ("min-word-length", 
+	                boost::program_options::value<int>()->default_value(0), 
+	                "leave out words with fewer characters than this, 0 for no minimum")
+	        ("max-word-length", 
+	                boost::program_options::value<int>()->default_value(2048), 
+	                "the most characters a word can have, see --long-words; 0 for no maximum, letting one word grow without bound")
+	        ("long-words", 
+	                boost::program_options::value<std::string>()->default_value("truncate"), 
+	                "what to do with words over --max-word-length: truncate, or skip")
+	        ("skip-numbers", 
+	                boost::program_options::bool_switch()->default_value(false), 
+	                "leave out words made only of digits, from any script")
+	        ("skip-hex", 
+	                boost::program_options::bool_switch()->default_value(false), 
+	                "leave out hex IDs: words of 4 or more characters made only of hex digits, with both letters and digits")
+	        ("max-digit-ratio", 
+	                boost::program_options::value<double>()->default_value(1.0), 
+	                "leave out words where more than this fraction of the characters are digits, from any script")
+	        ("order", 
+	                boost::program_options::value<std::string>()->default_value("readdir"), 
+	                "the order to process files in: readdir, inode, or extent (physical location on disk, via FIEMAP)")
+	        ("order-batch", 
+	                boost::program_options::value<int>()->default_value(1024), 
+	                "the number of found files to sort at a time when --order is inode or extent")
+	        ("readahead", 
+	                boost::program_options::value<int>()->default_value(0), 
+	                "the number of queued files to ask the kernel to read ahead while the current ones are processed")
+	        ("drop-cache", 
+	                boost::program_options::bool_switch()->default_value(false), 
+	                "drop each file from the page cache after it is processed, to avoid evicting other applications' data")
+	        ("io-threads", 
+	                boost::program_options::value<int>()->default_value(0), 
+	                "the number of threads for files that are not in the page cache; cached files go straight to the file processor threads")
+	        ("direct-io", 
+	                boost::program_options::bool_switch()->default_value(false), 
+	                "read files with O_DIRECT, bypassing the page cache; falls back to buffered reads where O_DIRECT is not supported")
+	        ("direct-queue-depth", 
+	                boost::program_options::value<int>()->default_value(4), 
+	                "the number of 1MB O_DIRECT reads to keep in flight per file")
+	        ("max-mbps", 
+	                boost::program_options::value<double>()->default_value(0), 
+	                "limit reads to this many MB per second across all threads, 0 for no limit")
+	        ("max-files-per-sec", 
+	                boost::program_options::value<double>()->default_value(0), 
+	                "limit the number of files opened per second across all threads, 0 for no limit")
+	        ("io-class", 
+	                boost::program_options::value<std::string>()->default_value("none"), 
+	                "the I/O scheduling class to run in: none (inherit), best-effort, or idle")
+	        ("io-level", 
+	                boost::program_options::value<int>()->default_value(4), 
+	                "the priority within the best-effort I/O class, 0 (highest) to 7 (lowest)")
+	        ("cpu-duty", 
+	                boost::program_options::value<int>()->default_value(100), 
+	                "the percentage of a CPU each file processor thread may use, 1-100")
+	        ("traversal", 
+	                boost::program_options::value<std::string>()->default_value("dfs"), 
+	                "the order to search directories in: dfs (depth first) or bfs (breadth first)")
+	        ("max-open-dirs", 
+	                boost::program_options::value<int>()->default_value(64), 
+	                "the most directories to hold open at once during a depth first search")
+	        ("traversal-cache", 
+	                boost::program_options::value<std::string>(), 
+	                "keep a snapshot of the search in this file and only re-read directories that changed since the last run")
+	        ("files-from", 
+	                boost::program_options::value<std::string>(), 
+	                "process the files listed in this file (- for stdin) instead of searching PATH")
+	        ("null,0", 
+	                boost::program_options::bool_switch()->default_value(false), 
+	                "paths in the --files-from list are separated by NUL characters instead of newlines")
+	        ("checkpoint", 
+	                boost::program_options::value<std::string>(), 
+	                "periodically save progress to this file so an interrupted run can be resumed")
+	        ("checkpoint-interval", 
+	                boost::program_options::value<int>()->default_value(60), 
+	                "the number of seconds between checkpoints")
+	        ("resume", 
+	                boost::program_options::bool_switch()->default_value(false), 
+	                "continue from the --checkpoint file instead of starting over")
+	        ("time-budget", 
+	                boost::program_options::value<double>()->default_value(0), 
+	                "stop after this many seconds and report the words counted so far, 0 for no limit")
+	        ("byte-budget", 
+	                boost::program_options::value<double>()->default_value(0), 
+	                "stop after reading this many MB and report the words counted so far, 0 for no limit")
+	        ("sample", 
+	                boost::program_options::value<int>()->default_value(0), 
+	                "process a random sample of this many of the files found and estimate the counts for all of them, 0 to process every file")
+	        ("sample-tolerance", 
+	                boost::program_options::value<double>()->default_value(0.05, "0.05"), 
+	                "stop sampling early once the top words are stable and their 95% confidence intervals are within this fraction of their counts")
 	        ;
 
 		boost::program_options::options_description hiddenOptions;
@@ -53,7 +167,8 @@ public:
 		// Create the help message
 		std::stringstream buffer;
 		buffer << "Usage: ssfi PATH [options]" << std::endl;
-		buffer << "Index all text files in PATH" << std::endl;
+		buffer << "       ssfi --files-from FILE [options]" << std::endl;
+		buffer << "Index all text files in PATH, or all files listed in FILE" << std::endl;
 		buffer << std::endl;
 		buffer << generalOptions << std::endl;
 		mHelpMessage = buffer.str();
@@ -96,13 +211,138 @@ public:
 		if (mVarMap.count("help"))
 			return;
 
-		if (mVarMap.count("path") <= 0)
+		if (mVarMap.count("path") <= 0 && mVarMap.count("files-from") <= 0)
 		{
-			throw ProgramOptionsException("You must specify a PATH to index");
+			throw ProgramOptionsException("You must specify a PATH to index or a --files-from list");
 		}
 		
 		if (mVarMap["threads"].as<int>() <= 0)
 			throw ProgramOptionsException("option 'threads' must be a positive integer");
+
+		if (mVarMap["aggregators"].as<int>() < 0)
+			throw ProgramOptionsException("option 'aggregators' must not be negative");
+
+		const std::string &wordStore = mVarMap["word-store"].as<std::string>();
+		if (wordStore != "bins" && wordStore != "lock-free")
+			throw ProgramOptionsException("option 'word-store' must be bins or lock-free");
+
+		const std::string &tokenizer = mVarMap["tokenizer"].as<std::string>();
+		if (tokenizer != "unicode" && tokenizer != "ascii" && tokenizer != "code" && tokenizer != "hyphen" && tokenizer != "case-sensitive")
+			throw ProgramOptionsException("option 'tokenizer' must be one of unicode, ascii, code, hyphen, case-sensitive");
+
+		if (mVarMap["min-word-length"].as<int>() < 0)
+			throw ProgramOptionsException("option 'min-word-length' must not be negative");
+
+		if (mVarMap["max-word-length"].as<int>() < 0)
+			throw ProgramOptionsException("option 'max-word-length' must not be negative");
+
+		const std::string &longWords = mVarMap["long-words"].as<std::string>();
+		if (longWords != "truncate" && longWords != "skip")
+			throw ProgramOptionsException("option 'long-words' must be one of truncate, skip");
+
+		if (mVarMap["max-digit-ratio"].as<double>() < 0 || mVarMap["max-digit-ratio"].as<double>() > 1)
+			throw ProgramOptionsException("option 'max-digit-ratio' must be between 0 and 1");
+
+		const std::string &order = mVarMap["order"].as<std::string>();
+		if (order != "readdir" && order != "inode" && order != "extent")
+			throw ProgramOptionsException("option 'order' must be one of readdir, inode, extent");
+
+		if (mVarMap["order-batch"].as<int>() <= 0)
+			throw ProgramOptionsException("option 'order-batch' must be a positive integer");
+
+		if (mVarMap["readahead"].as<int>() < 0)
+			throw ProgramOptionsException("option 'readahead' must not be negative");
+
+		if (mVarMap["io-threads"].as<int>() < 0)
+			throw ProgramOptionsException("option 'io-threads' must not be negative");
+
+		if (mVarMap["direct-queue-depth"].as<int>() <= 0)
+			throw ProgramOptionsException("option 'direct-queue-depth' must be a positive integer");
+
+		if (mVarMap["max-mbps"].as<double>() < 0)
+			throw ProgramOptionsException("option 'max-mbps' must not be negative");
+
+		if (mVarMap["max-files-per-sec"].as<double>() < 0)
+			throw ProgramOptionsException("option 'max-files-per-sec' must not be negative");
+
+		const std::string &ioClass = mVarMap["io-class"].as<std::string>();
+		if (ioClass != "none" && ioClass != "best-effort" && ioClass != "idle")
+			throw ProgramOptionsException("option 'io-class' must be one of none, best-effort, idle");
+
+		if (mVarMap["io-level"].as<int>() < 0 || mVarMap["io-level"].as<int>() > 7)
+			throw ProgramOptionsException("option 'io-level' must be between 0 and 7");
+
+		if (mVarMap["cpu-duty"].as<int>() < 1 || mVarMap["cpu-duty"].as<int>() > 100)
+			throw ProgramOptionsException("option 'cpu-duty' must be between 1 and 100");
+
+		const std::string &traversal = mVarMap["traversal"].as<std::string>();
+		if (traversal != "dfs" && traversal != "bfs")
+			throw ProgramOptionsException("option 'traversal' must be one of dfs, bfs");
+
+		if (mVarMap["max-open-dirs"].as<int>() <= 0)
+			throw ProgramOptionsException("option 'max-open-dirs' must be a positive integer");
+
+		if (mVarMap["checkpoint-interval"].as<int>() <= 0)
+			throw ProgramOptionsException("option 'checkpoint-interval' must be a positive integer");
+
+		if (mVarMap["resume"].as<bool>() && mVarMap.count("checkpoint") <= 0)
+			throw ProgramOptionsException("option 'resume' requires option 'checkpoint'");
+
+		if (mVarMap["time-budget"].as<double>() < 0)
+			throw ProgramOptionsException("option 'time-budget' must not be negative");
+
+		if (mVarMap["byte-budget"].as<double>() < 0)
+			throw ProgramOptionsException("option 'byte-budget' must not be negative");
+
+		if (mVarMap["sample"].as<int>() < 0)
+			throw ProgramOptionsException("option 'sample' must not be negative");
+
+		if (mVarMap["sample-tolerance"].as<double>() < 0)
+			throw ProgramOptionsException("option 'sample-tolerance' must not be negative");
+
+		if (mVarMap["sample"].as<int>() > 0 && mVarMap.count("checkpoint") > 0)
+			throw ProgramOptionsException("option 'sample' cannot be used with option 'checkpoint'");
+
+		if (mVarMap["aggregators"].as<int>() > 0 && mVarMap.count("checkpoint") > 0)
+			throw ProgramOptionsException("option 'aggregators' cannot be used with option 'checkpoint'");
+
+		if (mVarMap["aggregators"].as<int>() > 0 && !mVarMap["word-store"].defaulted())
+			throw ProgramOptionsException("option 'aggregators' cannot be used with option 'word-store'");
+
+		const std::string &hugePages = mVarMap["huge-pages"].as<std::string>();
+		if (hugePages != "off" && hugePages != "transparent" && hugePages != "explicit")
+			throw ProgramOptionsException("option 'huge-pages' must be one of off, transparent, explicit");
+
+		if (mVarMap["numa"].as<bool>())
+		{
+			if (mVarMap["aggregators"].as<int>() > 0)
+				throw ProgramOptionsException("option 'numa' cannot be used with option 'aggregators'");
+			if (mVarMap["dictionary"].as<bool>())
+				throw ProgramOptionsException("option 'numa' cannot be used with option 'dictionary'");
+		}
+
+		if (mVarMap.count("vocabulary") > 0)
+		{
+			if (mVarMap["aggregators"].as<int>() > 0)
+				throw ProgramOptionsException("option 'vocabulary' cannot be used with option 'aggregators'");
+			if (mVarMap["dictionary"].as<bool>())
+				throw ProgramOptionsException("option 'vocabulary' cannot be used with option 'dictionary'");
+		}
+
+		if (mVarMap["dictionary"].as<bool>())
+		{
+			if (mVarMap["aggregators"].as<int>() > 0)
+				throw ProgramOptionsException("option 'dictionary' cannot be used with option 'aggregators'");
+			if (!mVarMap["word-store"].defaulted())
+				throw ProgramOptionsException("option 'dictionary' cannot be used with option 'word-store'");
+			if (mVarMap.count("checkpoint") > 0)
+				throw ProgramOptionsException("option 'dictionary' cannot be used with option 'checkpoint'");
+			if (mVarMap["sample"].as<int>() > 0)
+				throw ProgramOptionsException("option 'dictionary' cannot be used with option 'sample'");
+		}
+
+		if (mVarMap["aggregators"].as<int>() > 0 && mVarMap["sample"].as<int>() > 0)
+			throw ProgramOptionsException("option 'aggregators' cannot be used with option 'sample'");
 	}
 
 	/**
@@ -114,6 +354,16 @@ public:
 		return (mVarMap.count("help") > 0);
 	}
 
+	/**
+	 * Check if an option without a default value was specified
+	 * @param optionName	The name of the option to check
+	 * @return				True if the option is present
+	 */
+	bool HasOption(const std::string &optionName) const
+	{
+		return (mVarMap.count(optionName) > 0);
+	}
+
 	/**
 	 * Return the value of an option, or throw an exception if the option is not present
 	 * @param optionName	The name of the option to retrieve
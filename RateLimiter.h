@@ -0,0 +1,83 @@
+#ifndef RATELIMITER_H
+#define RATELIMITER_H
+
+#include <algorithm>
+#include <atomic>
+#include <boost/thread/thread.hpp>
+#include <chrono>
+#include <stdint.h>
+
+/**
+ * The RateLimiter class is a thread-safe, lock-free token bucket.  Callers reserve their share of the rate with a single
+ * compare-and-swap and then sleep off any debt on their own, so there is no lock to contend on even when many threads
+ * are being held back
+ */
+class RateLimiter
+{
+public:
+
+	/**
+	 * RateLimiter constructor
+	 *
+	 * @param ratePerSecond		The sustained number of units allowed per second, 0 for no limit
+	 * @param burst				The number of units that may go through at once after the limiter has been idle
+	 */
+	RateLimiter(const double &ratePerSecond = 0, const double &burst = 0)
+		: mNanosPerUnit(ratePerSecond > 0 ? 1e9 / ratePerSecond : 0),
+		  mBurstNanos(static_cast<int64_t>(burst * mNanosPerUnit)),
+		  mNextStart(0)
+	{ }
+
+	/**
+	 * Take units from the bucket, sleeping until the rate allows them through
+	 *
+	 * @param amount	The number of units
+	 */
+	void Acquire(const uint64_t &amount)
+	{
+		if (mNanosPerUnit <= 0)
+			return;
+
+		// Reserve the next slot of time: it starts where the last reservation ended, or as far back as the burst allows
+		// if the limiter has been idle
+		int64_t cost = static_cast<int64_t>(amount * mNanosPerUnit);
+		int64_t now = Now();
+		int64_t start = mNextStart.load(std::memory_order_relaxed);
+		int64_t reserved;
+		do
+		{
+			reserved = std::max(start, now - mBurstNanos);
+		} while (!mNextStart.compare_exchange_weak(start, reserved + cost, std::memory_order_relaxed));
+
+		if (reserved > now)
+			boost::this_thread::sleep_for(boost::chrono::nanoseconds(reserved - now));
+	}
+
+	/**
+	 * Check if this limiter limits anything
+	 *
+	 * @return	True if a rate was set
+	 */
+	bool IsLimited() const
+	{
+		return mNanosPerUnit > 0;
+	}
+
+
+private:
+	double mNanosPerUnit;
+	int64_t mBurstNanos;
+	std::atomic<int64_t> mNextStart;	// The time the next reservation may start, in steady clock nanoseconds
+
+	static int64_t Now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// No copying
+	RateLimiter(const RateLimiter&);
+	RateLimiter& operator=(const RateLimiter& other);
+
+};
+
+#endif // RATELIMITER_H
@@ -0,0 +1,112 @@
+#ifndef READAHEADWINDOW_H
+#define READAHEADWINDOW_H
+
+#include <boost/thread/mutex.hpp>
+#include <deque>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+/**
+ * The ReadaheadWindow class tracks the queue of files waiting to be processed and asks the kernel to start reading the
+ * next few of them into the page cache while the processing threads are busy with the current ones
+ */
+class ReadaheadWindow
+{
+public:
+
+	/**
+	 * ReadaheadWindow constructor
+	 *
+	 * @param depth	How many files past the newest file being processed to read ahead
+	 */
+	ReadaheadWindow(const size_t &depth)
+		: mDepth(depth),
+		  mNextSequence(1),
+		  mStartedSequence(0)
+	{ }
+
+	/**
+	 * Add a file to the back of the queue.  Call this in the same order the files are posted for processing
+	 *
+	 * @param filename	The full path/name of the file
+	 * @return			The position of the file in the queue, to pass to FileStarted when it is processed.  Never 0
+	 */
+	uint64_t AddFile(const std::string &filename)
+	{
+		uint64_t sequence;
+		bool hintNow = false;
+		{
+			boost::mutex::scoped_lock lock(mMutex);
+			sequence = mNextSequence++;
+
+			// If the processing threads are already within reach of this file there is nothing to wait for
+			hintNow = mStartedSequence > 0 && sequence <= mStartedSequence + mDepth;
+			if (!hintNow)
+				mPending.emplace_back(sequence, filename);
+		}
+		if (hintNow)
+			Hint(filename);
+		return sequence;
+	}
+
+	/**
+	 * Note that a processing thread is starting on a file, and read ahead the files that are now within the window
+	 *
+	 * @param sequence	The position of the file in the queue, from AddFile
+	 */
+	void FileStarted(const uint64_t &sequence)
+	{
+		std::vector<std::string> toHint;
+		{
+			boost::mutex::scoped_lock lock(mMutex);
+			if (sequence <= mStartedSequence)
+				return;
+			mStartedSequence = sequence;
+
+			while (!mPending.empty() && mPending.front().first <= sequence + mDepth)
+			{
+				// Files that are already being processed don't need a hint
+				if (mPending.front().first > sequence)
+					toHint.push_back(std::move(mPending.front().second));
+				mPending.pop_front();
+			}
+		}
+
+		// Issue the hints outside the lock, they each cost an open/close
+		for (const auto &filename : toHint)
+			Hint(filename);
+	}
+
+
+private:
+	size_t mDepth;
+	uint64_t mNextSequence;
+	uint64_t mStartedSequence;	// The newest file a processing thread has started on, 0 before the first one
+	std::deque<std::pair<uint64_t, std::string> > mPending;
+	boost::mutex mMutex;
+
+	/**
+	 * Ask the kernel to start reading a file into the page cache.  This does not wait for the reads to complete
+	 *
+	 * @param filename	The full path/name of the file
+	 */
+	static void Hint(const std::string &filename)
+	{
+		int fd = open(filename.c_str(), O_RDONLY);
+		if (fd < 0)
+			return;
+		posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+		close(fd);
+	}
+
+	// No copying
+	ReadaheadWindow(const ReadaheadWindow&);
+	ReadaheadWindow& operator=(const ReadaheadWindow& other);
+
+};
+
+#endif // READAHEADWINDOW_H
@@ -0,0 +1,212 @@
+#ifndef SAMPLEESTIMATOR_H
+#define SAMPLEESTIMATOR_H
+
+#include <algorithm>
+#include <boost/thread/mutex.hpp>
+#include <cmath>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * An extrapolated word count with its 95% confidence interval
+ */
+struct WordEstimate
+{
+	std::string word;
+	double count;		// Estimated occurances across every file found
+	double margin;		// Half the width of the confidence interval around count
+	bool certain;		// The word is in the top words even at the ends of the confidence intervals
+};
+
+/**
+ * The SampleEstimator class extrapolates word counts from a uniform random sample of files to every file found.  Each
+ * file is one observation; the per-word sum and sum of squares across the sampled files give the mean count per file,
+ * its variance, and from those a confidence interval on the total.  It also decides when the top words have settled
+ * enough to stop sampling.  Thread-safe
+ */
+class SampleEstimator
+{
+public:
+
+	/**
+	 * SampleEstimator constructor
+	 *
+	 * @param topCount	The number of top words the caller is interested in
+	 * @param tolerance	Sampling has converged when every top word's interval is within this fraction of its count
+	 */
+	SampleEstimator(const size_t &topCount = 10, const double &tolerance = 0.05)
+		: mTopCount(topCount),
+		  mTolerance(tolerance),
+		  mPopulation(0),
+		  mFilesSampled(0)
+	{ }
+
+	/**
+	 * Set the number of files the sample was drawn from.  Must be called before files are added
+	 *
+	 * @param files	The number of files found
+	 */
+	void SetPopulation(const uint64_t &files)
+	{
+		boost::mutex::scoped_lock lock(mMutex);
+		mPopulation = files;
+	}
+
+	/**
+	 * Add the word counts of one sampled file
+	 *
+	 * @param fileWords	Every word in the file and the number of times it occurs
+	 * @return			True if the top words have converged and no more files are needed
+	 */
+	bool AddFile(const std::unordered_map<std::string, int> &fileWords)
+	{
+		boost::mutex::scoped_lock lock(mMutex);
+		for (const auto &word : fileWords)
+		{
+			WordTotals &totals = mWords[word.first];
+			totals.sum += word.second;
+			totals.sumSquares += static_cast<double>(word.second) * word.second;
+		}
+		mFilesSampled++;
+
+		// Checking means ranking the whole vocabulary, so only do it every so often, and not until there are enough
+		// files for the variances to mean something
+		if (mFilesSampled < MIN_FILES || mFilesSampled % CHECK_INTERVAL != 0)
+			return false;
+		return CheckConverged();
+	}
+
+	/**
+	 * Get the top words by estimated count
+	 *
+	 * @return	Up to topCount estimates, sorted from highest count to lowest
+	 */
+	std::vector<WordEstimate> ListTopEstimates() const
+	{
+		boost::mutex::scoped_lock lock(mMutex);
+		return TopEstimates();
+	}
+
+	/**
+	 * Get the number of different words in the files sampled so far
+	 */
+	size_t GetUniqueWordCount() const
+	{
+		boost::mutex::scoped_lock lock(mMutex);
+		return mWords.size();
+	}
+
+	/**
+	 * Get the number of files added to the sample so far
+	 */
+	uint64_t GetFilesSampled() const
+	{
+		boost::mutex::scoped_lock lock(mMutex);
+		return mFilesSampled;
+	}
+
+
+private:
+	static constexpr uint64_t MIN_FILES = 30;
+	static constexpr uint64_t CHECK_INTERVAL = 16;
+	static constexpr double CONFIDENCE_Z = 1.96;	// Two-sided 95%
+
+	struct WordTotals
+	{
+		WordTotals()
+			: sum(0),
+			  sumSquares(0)
+		{ }
+
+		uint64_t sum;		// Occurances across the sampled files
+		double sumSquares;	// Sum over the sampled files of the square of the occurances in each
+	};
+
+	size_t mTopCount;
+	double mTolerance;
+	uint64_t mPopulation;
+	uint64_t mFilesSampled;
+	std::unordered_map<std::string, WordTotals> mWords;
+	std::vector<std::string> mLastTop;	// The top words at the last convergence check, in order
+	mutable boost::mutex mMutex;
+
+	/**
+	 * Estimate the top words; mMutex must be held
+	 */
+	std::vector<WordEstimate> TopEstimates() const
+	{
+		std::vector<WordEstimate> estimates;
+		if (mFilesSampled == 0)
+			return estimates;
+
+		// The counts rank the same way as the sums, so only the words that make the cut need their intervals worked out.
+		// One word past the cut is kept to judge membership against
+		std::vector<std::pair<uint64_t, const std::string*> > ranked;
+		ranked.reserve(mWords.size());
+		for (const auto &word : mWords)
+			ranked.emplace_back(word.second.sum, &word.first);
+		size_t keep = std::min(mTopCount + 1, ranked.size());
+		std::partial_sort(ranked.begin(),
+						  ranked.begin() + keep,
+						  ranked.end(),
+						  [](const std::pair<uint64_t, const std::string*>& a, const std::pair<uint64_t, const std::string*>& b)
+						  {
+							  return a.first > b.first;
+						  });
+
+		double n = static_cast<double>(mFilesSampled);
+		double population = std::max(static_cast<double>(mPopulation), n);
+		double finiteCorrection = 1.0 - n / population;
+		for (size_t i = 0; i < keep; ++i)
+		{
+			const WordTotals &totals = mWords.at(*ranked[i].second);
+			double mean = totals.sum / n;
+			double variance = (n > 1 ? std::max(0.0, (totals.sumSquares - totals.sum * mean) / (n - 1)) : 0.0);
+			WordEstimate estimate;
+			estimate.word = *ranked[i].second;
+			estimate.count = population * mean;
+			estimate.margin = CONFIDENCE_Z * population * std::sqrt(variance / n * finiteCorrection);
+			estimate.certain = true;
+			estimates.push_back(estimate);
+		}
+
+		// A top word is certain if its lower bound clears the upper bound of the first word that missed the cut
+		if (estimates.size() > mTopCount)
+		{
+			double cutoff = estimates.back().count + estimates.back().margin;
+			estimates.pop_back();
+			for (auto &estimate : estimates)
+				estimate.certain = (estimate.count - estimate.margin > cutoff);
+		}
+		return estimates;
+	}
+
+	/**
+	 * Check if the top words are the same as at the last check and all have tight enough intervals; mMutex must be held
+	 */
+	bool CheckConverged()
+	{
+		std::vector<WordEstimate> estimates = TopEstimates();
+		std::vector<std::string> top;
+		bool tight = true;
+		for (const auto &estimate : estimates)
+		{
+			top.push_back(estimate.word);
+			if (estimate.margin > mTolerance * estimate.count)
+				tight = false;
+		}
+
+		bool stable = (top == mLastTop);
+		mLastTop.swap(top);
+		return stable && tight;
+	}
+
+	// No copying
+	SampleEstimator(const SampleEstimator&);
+	SampleEstimator& operator=(const SampleEstimator& other);
+
+};
+
+#endif // SAMPLEESTIMATOR_H
@@ -0,0 +1,165 @@
+#ifndef STOPWORDS_H
+#define STOPWORDS_H
+
+#include <array>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "PerfectHash.h"
+
+/**
+ * FNV-1a hash of a word
+ */
+constexpr uint64_t StopWordHash(const std::string_view &word)
+{
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	for (char c : word)
+	{
+		hash ^= static_cast<unsigned char>(c);
+		hash *= 0x100000001B3ULL;
+	}
+	return hash;
+}
+
+// The built-in list, the usual English function words plus the pieces contractions split into
+constexpr std::string_view BUILT_IN_STOP_WORDS[] = {
+	"a", "about", "above", "after", "again", "against", "all", "am", "an", "and", "any", "are", "as", "at", "be",
+	"because", "been", "before", "being", "below", "between", "both", "but", "by", "can", "could", "d", "did", "do",
+	"does", "doing", "don", "down", "during", "each", "few", "for", "from", "further", "had", "has", "have", "having",
+	"he", "her", "here", "hers", "herself", "him", "himself", "his", "how", "i", "if", "in", "into", "is", "it", "its",
+	"itself", "just", "ll", "m", "me", "more", "most", "my", "myself", "no", "nor", "not", "now", "of", "off", "on",
+	"once", "only", "or", "other", "our", "ours", "ourselves", "out", "over", "own", "re", "s", "same", "she",
+	"should", "so", "some", "such", "t", "than", "that", "the", "their", "theirs", "them", "themselves", "then",
+	"there", "these", "they", "this", "those", "through", "to", "too", "under", "until", "up", "ve", "very", "was",
+	"we", "were", "what", "when", "where", "which", "while", "who", "whom", "why", "will", "with", "would", "you",
+	"your", "yours", "yourself", "yourselves"
+};
+constexpr size_t BUILT_IN_STOP_COUNT = sizeof(BUILT_IN_STOP_WORDS) / sizeof(BUILT_IN_STOP_WORDS[0]);
+constexpr size_t BUILT_IN_STOP_TABLE_SIZE = 2048;
+constexpr uint8_t BUILT_IN_STOP_EMPTY = 0xFF;
+static_assert(BUILT_IN_STOP_COUNT < BUILT_IN_STOP_EMPTY, "the built-in table indexes words with a byte");
+
+/**
+ * Find a seed that sends every built-in word to a different slot
+ */
+constexpr uint64_t FindBuiltInStopWordSeed()
+{
+	for (uint64_t seed = 1; ; ++seed)
+	{
+		std::array<bool, BUILT_IN_STOP_TABLE_SIZE> used {};
+		bool collision = false;
+		for (size_t i = 0; i < BUILT_IN_STOP_COUNT && !collision; ++i)
+		{
+			size_t slot = PerfectHashMix(StopWordHash(BUILT_IN_STOP_WORDS[i]), seed) & (BUILT_IN_STOP_TABLE_SIZE - 1);
+			collision = used[slot];
+			used[slot] = true;
+		}
+		if (!collision)
+			return seed;
+	}
+}
+
+/**
+ * Lay the built-in words out in their slots, each slot holding the index of its word or BUILT_IN_STOP_EMPTY
+ */
+constexpr std::array<uint8_t, BUILT_IN_STOP_TABLE_SIZE> MakeBuiltInStopWordTable(const uint64_t seed)
+{
+	std::array<uint8_t, BUILT_IN_STOP_TABLE_SIZE> table {};
+	for (auto &slot : table)
+		slot = BUILT_IN_STOP_EMPTY;
+	for (size_t i = 0; i < BUILT_IN_STOP_COUNT; ++i)
+		table[PerfectHashMix(StopWordHash(BUILT_IN_STOP_WORDS[i]), seed) & (BUILT_IN_STOP_TABLE_SIZE - 1)] = static_cast<uint8_t>(i);
+	return table;
+}
+
+constexpr uint64_t BUILT_IN_STOP_SEED = FindBuiltInStopWordSeed();
+constexpr std::array<uint8_t, BUILT_IN_STOP_TABLE_SIZE> BUILT_IN_STOP_TABLE = MakeBuiltInStopWordTable(BUILT_IN_STOP_SEED);
+
+/**
+ * The StopWords class is a set of words to leave out of the counts, such as "the" and "and", checked for every word
+ * found so it has to cost next to nothing.  The built-in English list is laid out with a perfect hash found at compile
+ * time; a list loaded from a file gets a PerfectHash built when it is loaded.  Either way a lookup is one hash of the
+ * word, one or two table reads and one string compare.  Not thread-safe to change, safe to read from any number of
+ * threads
+ */
+class StopWords
+{
+public:
+
+	/**
+	 * StopWords constructor.  The set starts out empty
+	 */
+	StopWords()
+		: mBuiltIn(false)
+	{ }
+
+	/**
+	 * Use the built-in list of common English words
+	 */
+	void UseBuiltIn()
+	{
+		mBuiltIn = true;
+		mLoaded.Clear();
+	}
+
+	/**
+	 * Load a list of words from a file, separated by whitespace.  Words must be written the way the tokenizer produces
+	 * them, so lowercase unless case-sensitive words are being counted
+	 *
+	 * @param path	The file to read
+	 * @return		WordListStatus::Loaded if the words were loaded; otherwise there are no stop words
+	 */
+	WordListStatus Load(const std::string &path)
+	{
+		mBuiltIn = false;
+		mLoaded.Clear();
+		std::vector<std::string> words;
+		if (!ReadWordList(path, words))
+			return WordListStatus::Unreadable;
+
+		std::vector<uint64_t> hashes;
+		hashes.reserve(words.size());
+		for (const auto &stopWord : words)
+			hashes.push_back(StopWordHash(stopWord));
+		if (!mLoaded.Build(words, hashes))
+			return WordListStatus::Unhashable;
+		return WordListStatus::Loaded;
+	}
+
+	/**
+	 * Check if a word is a stop word
+	 *
+	 * @param word	The word to check
+	 * @return		True if the word should not be counted
+	 */
+	bool Contains(const std::string_view &word) const
+	{
+		if (mBuiltIn)
+		{
+			uint8_t index = BUILT_IN_STOP_TABLE[PerfectHashMix(StopWordHash(word), BUILT_IN_STOP_SEED) & (BUILT_IN_STOP_TABLE_SIZE - 1)];
+			return index != BUILT_IN_STOP_EMPTY && BUILT_IN_STOP_WORDS[index] == word;
+		}
+		return mLoaded.Find(word, StopWordHash(word)) != PerfectHash::NOT_FOUND;
+	}
+
+	/**
+	 * Check if there are no stop words
+	 */
+	bool Empty() const
+	{
+		return !mBuiltIn && mLoaded.Size() == 0;
+	}
+
+
+private:
+	bool mBuiltIn;
+	PerfectHash mLoaded;	// The words loaded from a file
+
+	// No copying
+	StopWords(const StopWords&);
+	StopWords& operator=(const StopWords& other);
+
+};
+
+#endif // STOPWORDS_H
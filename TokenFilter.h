@@ -0,0 +1,84 @@
+#ifndef TOKENFILTER_H
+#define TOKENFILTER_H
+
+#include <stddef.h>
+
+/**
+ * What to do with a word longer than the maximum length
+ */
+enum class LongWordAction
+{
+	Truncate,	// Count the first maxLength characters
+	Skip		// Leave the word out
+};
+
+/**
+ * Rules for leaving words out by their length and shape, mostly to keep the hex IDs, numbers and UUID fragments in logs
+ * out of the vocabulary.  A Tokenizer applies them as each word ends, from counts it keeps while building the word, so a
+ * word that is left out never reaches the word counts
+ */
+struct TokenFilter
+{
+	TokenFilter()
+		: minLength(0),
+		  maxLength(0),
+		  longWords(LongWordAction::Truncate),
+		  skipNumbers(false),
+		  skipHex(false),
+		  maxDigitRatio(1.0)
+	{ }
+
+	// The fewest characters a word can have to look like a hex ID; shorter runs of hex digits are often real words
+	static constexpr size_t HEX_MIN_LENGTH = 4;
+
+	size_t minLength;			// The fewest characters a word can have, 0 for no minimum
+	size_t maxLength;			// The most characters a word can have, 0 for no maximum
+	LongWordAction longWords;	// What to do with words over maxLength
+	bool skipNumbers;			// Leave out words made only of digits, from any script
+	bool skipHex;				// Leave out words made only of ASCII hex digits, with both letters and digits
+	double maxDigitRatio;		// Leave out words where more than this fraction of the characters are digits, from any script
+
+	/**
+	 * Check if any of the rules can leave a word out.  A maximum length that truncates only shortens words
+	 */
+	bool Active() const
+	{
+		return minLength > 0 || (maxLength > 0 && longWords == LongWordAction::Skip) || NeedsShape();
+	}
+
+	/**
+	 * Check if any of the rules look at the digits and letters in a word, rather than just its length
+	 */
+	bool NeedsShape() const
+	{
+		return skipNumbers || skipHex || maxDigitRatio < 1.0;
+	}
+
+	/**
+	 * Decide whether to keep a word
+	 *
+	 * @param characters	The number of characters in the word, up to maxLength if it was truncated
+	 * @param digits		The number of ASCII digits in it
+	 * @param otherDigits	The number of decimal digits from other scripts in it, such as Arabic-Indic or Devanagari
+	 * @param hexLetters	The number of ASCII letters from a to f in it, either case
+	 * @param overlong		The word was longer than maxLength
+	 * @return				True if the word should be counted
+	 */
+	bool Keep(const size_t &characters, const size_t &digits, const size_t &otherDigits, const size_t &hexLetters,
+			  const bool &overlong) const
+	{
+		if (overlong && longWords == LongWordAction::Skip)
+			return false;
+		if (characters < minLength)
+			return false;
+		if (skipNumbers && digits + otherDigits == characters)
+			return false;
+		if (skipHex && digits > 0 && hexLetters > 0 && digits + hexLetters == characters && characters >= HEX_MIN_LENGTH)
+			return false;
+		if (digits + otherDigits > maxDigitRatio * characters)
+			return false;
+		return true;
+	}
+};
+
+#endif // TOKENFILTER_H
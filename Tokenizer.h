@@ -0,0 +1,437 @@
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <limits>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "TokenFilter.h"
+#include "TokenizerPolicies.h"
+#include "UnicodeTables.h"
+
+/**
+ * The Tokenizer class splits text into words following the rules of a policy from TokenizerPolicies.h.  With the default
+ * UnicodePolicy, a word is a run of Unicode letters, digits and combining marks, lowercased; everything else, including
+ * bytes that are not valid UTF-8, separates words.  ASCII goes through a byte table the policy builds at compile time,
+ * and when UTF-8 is decoded, runs of ASCII are found 16 bytes at a time so mostly English text pays almost nothing for
+ * the Unicode support.  Text can be fed in blocks of any size; words and characters split across blocks are put back
+ * together.  Words can also be left out by length and shape with a TokenFilter, checked as each word ends from counts
+ * kept while it is built.  Not thread-safe
+ */
+template<typename Policy = UnicodePolicy>
+class Tokenizer
+{
+public:
+
+	/**
+	 * Tokenizer constructor
+	 *
+	 * @param filter	Rules for leaving words out
+	 */
+	Tokenizer(const TokenFilter &filter = TokenFilter())
+		: mFilter(filter),
+		  mFiltering(filter.Active()),
+		  mCountingShape(filter.NeedsShape()),
+		  mMaxCharacters(filter.maxLength > 0 ? filter.maxLength : std::numeric_limits<size_t>::max()),
+		  mCharacters(0),
+		  mOverlong(false),
+		  mDigits(0),
+		  mOtherDigits(0),
+		  mHexLetters(0),
+		  mJoiner(0),
+		  mPendingLength(0),
+		  mPendingNeeded(0)
+	{
+		mWord.reserve(64);
+	}
+
+	/**
+	 * Tokenize the next block of text
+	 *
+	 * @param data		The text
+	 * @param length	The number of bytes in data
+	 * @param onWord	Called as onWord(const std::string &word) for every word completed in this block
+	 */
+	template<typename WordCallback>
+	void Add(const char *data, const size_t &length, WordCallback &onWord)
+	{
+		const unsigned char *bytes = reinterpret_cast<const unsigned char*>(data);
+		if constexpr (!Policy::DECODE_UTF8)
+		{
+			AddAscii(bytes, 0, length, onWord);
+			return;
+		}
+
+		size_t i = 0;
+
+		// Finish a character that was split across blocks
+		while (mPendingLength > 0 && mPendingLength < sizeof(mPending) && i < length)
+		{
+			if (!IsContinuation(bytes[i]))
+			{
+				mPendingLength = 0;
+				EndWord(onWord);
+				break;
+			}
+			mPending[mPendingLength++] = bytes[i++];
+			if (mPendingLength == mPendingNeeded)
+			{
+				AddSequence(mPending, mPendingLength, onWord);
+				mPendingLength = 0;
+			}
+		}
+
+		while (i < length)
+		{
+			size_t asciiEnd = i + AsciiPrefixLength(bytes + i, length - i);
+			AddAscii(bytes, i, asciiEnd, onWord);
+			i = asciiEnd;
+			if (i < length)
+				i += AddMultibyte(bytes + i, length - i, onWord);
+		}
+	}
+
+	/**
+	 * End the current word, as if a separator had been seen
+	 *
+	 * @param onWord	Called with the word, if there is one and the filter keeps it
+	 */
+	template<typename WordCallback>
+	void EndWord(WordCallback &onWord)
+	{
+		mJoiner = 0;
+		if (mWord.empty())
+			return;
+		if (!mFiltering || mFilter.Keep(mCharacters, mDigits, mOtherDigits, mHexLetters, mOverlong))
+			onWord(mWord);
+		mWord.clear();
+		mCharacters = 0;
+		mOverlong = false;
+		if (mCountingShape)
+		{
+			mDigits = 0;
+			mOtherDigits = 0;
+			mHexLetters = 0;
+		}
+	}
+
+	/**
+	 * Finish the text, ending the last word and dropping any incomplete character
+	 *
+	 * @param onWord	Called with the last word, if there is one
+	 */
+	template<typename WordCallback>
+	void Finish(WordCallback &onWord)
+	{
+		mPendingLength = 0;
+		EndWord(onWord);
+	}
+
+
+private:
+	static constexpr int ASCII_SIZE = 0x80;
+	static constexpr ByteTable BYTE_TABLE = MakeByteTable<Policy>();
+	TokenFilter mFilter;
+	bool mFiltering;
+	bool mCountingShape;		// Keep the digit and hex letter counts, which only some rules need
+	size_t mMaxCharacters;		// Characters past this are dropped from the word
+	std::string mWord;
+	size_t mCharacters;			// The number of characters in mWord, which can be less than its length in bytes
+	bool mOverlong;				// Characters were dropped from mWord for being past mMaxCharacters
+	// Counts for the filter, only kept when counting shape
+	size_t mDigits;				// The number of ASCII digits in mWord
+	size_t mOtherDigits;		// The number of decimal digits from other scripts in mWord
+	size_t mHexLetters;			// The number of ASCII letters from a to f in mWord
+	unsigned char mJoiner;		// A joiner seen after the current word, added if the word continues; 0 if none
+	unsigned char mPending[4];	// The start of a character split across blocks
+	size_t mPendingLength;
+	size_t mPendingNeeded;		// The full length of the split character
+
+	/**
+	 * Tokenize bytes by table lookup; with UTF-8 decoding they must all be ASCII
+	 */
+	template<typename WordCallback>
+	void AddAscii(const unsigned char *bytes, const size_t &begin, const size_t &end, WordCallback &onWord)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			unsigned char entry = BYTE_TABLE[bytes[i]];
+			if (entry > BYTE_JOINER)
+			{
+				AppendJoiner();
+				AppendAscii(static_cast<char>(entry));
+			}
+			else if (Policy::HAS_JOINERS && entry == BYTE_JOINER && !mWord.empty() && mJoiner == 0)
+			{
+				mJoiner = bytes[i];
+			}
+			else if (!mWord.empty())
+			{
+				EndWord(onWord);
+			}
+		}
+	}
+
+	/**
+	 * Add a joiner that turned out to be inside a word
+	 */
+	void AppendJoiner()
+	{
+		if constexpr (Policy::HAS_JOINERS)
+		{
+			if (mJoiner != 0)
+			{
+				// A truncated word shouldn't end in a joiner, so one needs room for a character after it
+				if (mCharacters >= mMaxCharacters - 1)
+					mOverlong = true;
+				else
+					AppendAscii(static_cast<char>(mJoiner));
+				mJoiner = 0;
+			}
+		}
+	}
+
+	/**
+	 * Append an ASCII character to the current word, keeping the counts the filter works from
+	 */
+	void AppendAscii(const char &c)
+	{
+		if (mOverlong || mCharacters >= mMaxCharacters)
+		{
+			mOverlong = true;
+			return;
+		}
+		mCharacters++;
+		if (mCountingShape)
+		{
+			mDigits += (static_cast<unsigned char>(c - '0') < 10);
+			mHexLetters += (static_cast<unsigned char>((c | 0x20) - 'a') < 6);
+		}
+		mWord.push_back(c);
+	}
+
+	/**
+	 * Count the ASCII bytes at the start of some text
+	 */
+	static size_t AsciiPrefixLength(const unsigned char *bytes, const size_t &length)
+	{
+		size_t i = 0;
+#ifdef __SSE2__
+		for (; i + 16 <= length; i += 16)
+		{
+			int highBits = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i)));
+			if (highBits != 0)
+				return i + __builtin_ctz(highBits);
+		}
+#endif
+		while (i < length && bytes[i] < ASCII_SIZE)
+			++i;
+		return i;
+	}
+
+	static bool IsContinuation(const unsigned char &byte)
+	{
+		return (byte & 0xC0) == 0x80;
+	}
+
+	/**
+	 * Get the length of a UTF-8 sequence from its first byte
+	 *
+	 * @return	2 to 4, or 0 if the byte cannot start a sequence
+	 */
+	static size_t SequenceLength(const unsigned char &lead)
+	{
+		if (lead >= 0xC2 && lead <= 0xDF)
+			return 2;
+		if (lead >= 0xE0 && lead <= 0xEF)
+			return 3;
+		if (lead >= 0xF0 && lead <= 0xF4)
+			return 4;
+		return 0;
+	}
+
+	/**
+	 * Tokenize the non-ASCII character at the start of some text
+	 *
+	 * @return	The number of bytes used
+	 */
+	template<typename WordCallback>
+	size_t AddMultibyte(const unsigned char *bytes, const size_t &length, WordCallback &onWord)
+	{
+		size_t needed = SequenceLength(bytes[0]);
+		if (needed == 0)
+		{
+			EndWord(onWord);
+			return 1;
+		}
+
+		// Hold on to a character that runs off the end of the block until the next block completes it
+		if (needed > length)
+		{
+			for (size_t i = 1; i < length; ++i)
+			{
+				if (!IsContinuation(bytes[i]))
+				{
+					EndWord(onWord);
+					return i;
+				}
+			}
+			memcpy(mPending, bytes, length);
+			mPendingLength = length;
+			mPendingNeeded = needed;
+			return length;
+		}
+		return AddSequence(bytes, needed, onWord);
+	}
+
+	/**
+	 * Decode and tokenize one complete UTF-8 sequence
+	 *
+	 * @param bytes		The sequence
+	 * @param length	Its length, from SequenceLength
+	 * @return			The number of bytes used; just the first byte if the sequence is invalid
+	 */
+	template<typename WordCallback>
+	size_t AddSequence(const unsigned char *bytes, const size_t &length, WordCallback &onWord)
+	{
+		uint32_t codePoint = bytes[0] & (0x7F >> length);
+		for (size_t i = 1; i < length; ++i)
+		{
+			if (!IsContinuation(bytes[i]))
+			{
+				EndWord(onWord);
+				return 1;
+			}
+			codePoint = (codePoint << 6) | (bytes[i] & 0x3F);
+		}
+
+		// Reject overlong encodings, surrogates and anything past the last code point
+		bool valid = (length == 2 || (length == 3 && codePoint >= 0x800 && (codePoint < 0xD800 || codePoint > 0xDFFF)) ||
+					  (length == 4 && codePoint >= 0x10000 && codePoint <= 0x10FFFF));
+		if (!valid)
+		{
+			EndWord(onWord);
+			return 1;
+		}
+
+		if (IsWordCodePoint(codePoint))
+		{
+			AppendJoiner();
+			AppendUtf8(Policy::FOLD_CASE ? Fold(codePoint) : codePoint);
+		}
+		else
+		{
+			EndWord(onWord);
+		}
+		return length;
+	}
+
+	/**
+	 * Check if a non-ASCII code point is part of a word
+	 */
+	static bool IsWordCodePoint(const uint32_t &codePoint)
+	{
+		return InRanges(UNICODE_WORD_RANGES, UNICODE_WORD_RANGE_COUNT, codePoint);
+	}
+
+	/**
+	 * Check if a non-ASCII code point is a decimal digit
+	 */
+	static bool IsDigitCodePoint(const uint32_t &codePoint)
+	{
+		return InRanges(UNICODE_DIGIT_RANGES, UNICODE_DIGIT_RANGE_COUNT, codePoint);
+	}
+
+	/**
+	 * Check if a code point is in one of a sorted list of inclusive ranges
+	 */
+	static bool InRanges(const uint32_t (*ranges)[2], const size_t &count, const uint32_t &codePoint)
+	{
+		// Find the last range starting at or before the code point
+		size_t low = 0;
+		size_t high = count;
+		while (low < high)
+		{
+			size_t middle = (low + high) / 2;
+			if (ranges[middle][0] <= codePoint)
+				low = middle + 1;
+			else
+				high = middle;
+		}
+		return low > 0 && codePoint <= ranges[low - 1][1];
+	}
+
+	/**
+	 * Get the simple lowercase form of a non-ASCII code point
+	 */
+	static uint32_t Fold(const uint32_t &codePoint)
+	{
+		size_t low = 0;
+		size_t high = UNICODE_FOLD_RANGE_COUNT;
+		int32_t value = static_cast<int32_t>(codePoint);
+		while (low < high)
+		{
+			size_t middle = (low + high) / 2;
+			if (UNICODE_FOLD_RANGES[middle][0] <= value)
+				low = middle + 1;
+			else
+				high = middle;
+		}
+		if (low == 0)
+			return codePoint;
+
+		const int32_t *range = UNICODE_FOLD_RANGES[low - 1];
+		if (value > range[1] || (value - range[0]) % range[3] != 0)
+			return codePoint;
+		return static_cast<uint32_t>(value + range[2]);
+	}
+
+	/**
+	 * Append a code point to the current word
+	 */
+	void AppendUtf8(const uint32_t &codePoint)
+	{
+		if (codePoint < 0x80)
+		{
+			AppendAscii(static_cast<char>(codePoint));
+			return;
+		}
+		if (mOverlong || mCharacters >= mMaxCharacters)
+		{
+			mOverlong = true;
+			return;
+		}
+		mCharacters++;
+		if (mCountingShape)
+			mOtherDigits += IsDigitCodePoint(codePoint);
+
+		if (codePoint < 0x800)
+		{
+			mWord.push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+			mWord.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+		}
+		else if (codePoint < 0x10000)
+		{
+			mWord.push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+			mWord.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+			mWord.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+		}
+		else
+		{
+			mWord.push_back(static_cast<char>(0xF0 | (codePoint >> 18)));
+			mWord.push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F)));
+			mWord.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+			mWord.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+		}
+	}
+
+	// No copying
+	Tokenizer(const Tokenizer&);
+	Tokenizer& operator=(const Tokenizer& other);
+
+};
+
+#endif // TOKENIZER_H
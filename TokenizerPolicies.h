@@ -0,0 +1,102 @@
+#ifndef TOKENIZERPOLICIES_H
+#define TOKENIZERPOLICIES_H
+
+#include <array>
+
+/**
+ * The sets of tokenizing rules that can be chosen at startup
+ */
+enum class WordRules
+{
+	Unicode,		// Unicode letters, digits and combining marks, lowercased
+	Ascii,			// ASCII letters and digits, lowercased; every other byte is a separator
+	Code,			// Like Unicode, with underscores as part of words, for identifiers in source code
+	Hyphenated,		// Like Unicode, with single hyphens inside a word kept, as in "well-known"
+	CaseSensitive	// Like Unicode, without lowercasing
+};
+
+/**
+ * What a byte means to a tokenizer: a separator, a joiner, the start or middle of a multibyte UTF-8 character, or
+ * otherwise the (possibly lowercased) ASCII character to add to the word
+ */
+using ByteTable = std::array<unsigned char, 256>;
+constexpr unsigned char BYTE_SEPARATOR = 0;
+constexpr unsigned char BYTE_JOINER = 1;		// Part of a word only between two word characters
+constexpr unsigned char BYTE_MULTIBYTE = 0x80;
+
+constexpr bool IsAsciiAlnum(const int c)
+{
+	return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+/**
+ * Build the byte table for a policy at compile time
+ */
+template<typename Policy>
+constexpr ByteTable MakeByteTable()
+{
+	ByteTable table {};
+	for (int c = 0; c < 256; ++c)
+	{
+		if (c >= 0x80)
+			table[c] = (Policy::DECODE_UTF8 ? BYTE_MULTIBYTE : BYTE_SEPARATOR);
+		else if (Policy::IsWordChar(c))
+			table[c] = static_cast<unsigned char>(Policy::FOLD_CASE && c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+		else if (Policy::IsJoiner(c))
+			table[c] = BYTE_JOINER;
+		else
+			table[c] = BYTE_SEPARATOR;
+	}
+	return table;
+}
+
+/**
+ * Tokenizer policies.  Each one says which ASCII characters make up words, which join two words into one, whether bytes
+ * past ASCII are decoded as UTF-8 (and classified with the Unicode tables) or are separators, and whether to lowercase
+ */
+struct UnicodePolicy
+{
+	static constexpr bool DECODE_UTF8 = true;
+	static constexpr bool FOLD_CASE = true;
+	static constexpr bool HAS_JOINERS = false;
+	static constexpr bool IsWordChar(const int c) { return IsAsciiAlnum(c); }
+	static constexpr bool IsJoiner(const int) { return false; }
+};
+
+struct AsciiPolicy
+{
+	static constexpr bool DECODE_UTF8 = false;
+	static constexpr bool FOLD_CASE = true;
+	static constexpr bool HAS_JOINERS = false;
+	static constexpr bool IsWordChar(const int c) { return IsAsciiAlnum(c); }
+	static constexpr bool IsJoiner(const int) { return false; }
+};
+
+struct CodePolicy
+{
+	static constexpr bool DECODE_UTF8 = true;
+	static constexpr bool FOLD_CASE = true;
+	static constexpr bool HAS_JOINERS = false;
+	static constexpr bool IsWordChar(const int c) { return IsAsciiAlnum(c) || c == '_'; }
+	static constexpr bool IsJoiner(const int) { return false; }
+};
+
+struct HyphenatedPolicy
+{
+	static constexpr bool DECODE_UTF8 = true;
+	static constexpr bool FOLD_CASE = true;
+	static constexpr bool HAS_JOINERS = true;
+	static constexpr bool IsWordChar(const int c) { return IsAsciiAlnum(c); }
+	static constexpr bool IsJoiner(const int c) { return c == '-'; }
+};
+
+struct CaseSensitivePolicy
+{
+	static constexpr bool DECODE_UTF8 = true;
+	static constexpr bool FOLD_CASE = false;
+	static constexpr bool HAS_JOINERS = false;
+	static constexpr bool IsWordChar(const int c) { return IsAsciiAlnum(c); }
+	static constexpr bool IsJoiner(const int) { return false; }
+};
+
+#endif // TOKENIZERPOLICIES_H
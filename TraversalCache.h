@@ -0,0 +1,346 @@
+#ifndef TRAVERSALCACHE_H
+#define TRAVERSALCACHE_H
+
+#include <algorithm>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <sys/stat.h>
+#include <time.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * The TraversalCache class keeps a compact snapshot of a directory search: a table of directories with their mtimes, a
+ * table of the regular files in them, and a single arena holding every name.  A walk loads the snapshot from the previous
+ * run and reuses the listing of any directory whose mtime has not changed, instead of reading and stat-ing its entries
+ * again, while recording a fresh snapshot to save for the next run.  Not thread-safe
+ */
+class TraversalCache
+{
+public:
+	static constexpr uint32_t NO_PARENT = 0xFFFFFFFF;
+
+	/**
+	 * The cached contents of a directory
+	 */
+	struct Listing
+	{
+		struct File
+		{
+			std::string name;
+			ino_t inode;
+			off_t size;		// The size when the snapshot was taken, which may be out of date
+		};
+
+		std::vector<File> files;					// Each regular file
+		std::vector<std::string> subdirectories;	// Name of each subdirectory
+	};
+
+	/**
+	 * TraversalCache constructor
+	 */
+	TraversalCache()
+		: mSnapshotTime(time(NULL))
+	{ }
+
+	/**
+	 * Load the snapshot saved by a previous run.  A missing or unreadable snapshot just means nothing is reused
+	 *
+	 * @param filename	The snapshot file
+	 * @return			True if a snapshot was loaded
+	 */
+	bool Load(const std::string &filename)
+	{
+		FILE *file = fopen(filename.c_str(), "rb");
+		if (file == NULL)
+			return false;
+
+		Header header;
+		struct stat fileStat;
+		bool loaded = fread(&header, sizeof(header), 1, file) == 1 &&
+					  memcmp(header.magic, Magic(), sizeof(header.magic)) == 0 &&
+					  header.version == VERSION &&
+					  fstat(fileno(file), &fileStat) == 0 &&
+					  SizesFit(header, static_cast<uint64_t>(fileStat.st_size));
+		if (loaded)
+		{
+			mOldDirectories.resize(header.directoryCount);
+			mOldFiles.resize(header.fileCount);
+			mOldArena.resize(header.arenaSize);
+			loaded = fread(mOldDirectories.data(), sizeof(DirectoryRecord), mOldDirectories.size(), file) == mOldDirectories.size() &&
+					 fread(mOldFiles.data(), sizeof(FileRecord), mOldFiles.size(), file) == mOldFiles.size() &&
+					 fread(&mOldArena[0], 1, mOldArena.size(), file) == mOldArena.size();
+		}
+		fclose(file);
+
+		if (!loaded || !IndexOldSnapshot())
+		{
+			mOldDirectories.clear();
+			mOldFiles.clear();
+			mOldArena.clear();
+			return false;
+		}
+		mOldSnapshotTime = header.snapshotTime;
+		return true;
+	}
+
+	/**
+	 * Look up the listing of a directory from the previous run
+	 *
+	 * @param path		The full path of the directory
+	 * @param dirStat	The current stat of the directory
+	 * @param listing	Filled in with the cached listing
+	 * @return			True if the directory is unchanged since the previous run and the listing can be used
+	 */
+	bool Lookup(const std::string &path, const struct stat &dirStat, Listing &listing) const
+	{
+		auto found = mOldPaths.find(path);
+		if (found == mOldPaths.end())
+			return false;
+
+		const DirectoryRecord &directory = mOldDirectories[found->second];
+		if (directory.mtimeSeconds != dirStat.st_mtim.tv_sec || directory.mtimeNanoseconds != dirStat.st_mtim.tv_nsec)
+			return false;
+
+		// A directory changed in the same second the previous snapshot was taken might have changed again afterwards
+		// without its mtime moving, so don't trust it
+		if (directory.mtimeSeconds >= mOldSnapshotTime - 1)
+			return false;
+
+		listing.files.clear();
+		listing.subdirectories.clear();
+		for (uint32_t i = mOldFileStart[found->second]; i < mOldFileStart[found->second + 1]; ++i)
+		{
+			const FileRecord &file = mOldFiles[mOldFileOrder[i]];
+			listing.files.push_back(Listing::File { mOldArena.substr(file.nameOffset, file.nameLength), static_cast<ino_t>(file.inode), static_cast<off_t>(file.size) });
+		}
+		for (uint32_t i = mOldSubdirectoryStart[found->second]; i < mOldSubdirectoryStart[found->second + 1]; ++i)
+		{
+			const DirectoryRecord &subdirectory = mOldDirectories[mOldSubdirectoryOrder[i]];
+			listing.subdirectories.push_back(mOldArena.substr(subdirectory.nameOffset, subdirectory.nameLength));
+		}
+		return true;
+	}
+
+	/**
+	 * Record a directory in the new snapshot
+	 *
+	 * @param parent	The index of the parent directory from AddDirectory, or NO_PARENT for the starting path
+	 * @param name		The name of the directory within its parent, or the full path for the starting path
+	 * @param dirStat	The stat of the directory
+	 * @param readable	False if the directory couldn't be opened.  It is still listed under its parent, so a reused
+	 * 					parent listing doesn't lose it, but its own listing is never reused
+	 * @return			The index of the directory, for AddFile and for its subdirectories
+	 */
+	uint32_t AddDirectory(uint32_t parent, const std::string &name, const struct stat &dirStat, const bool &readable = true)
+	{
+		DirectoryRecord directory;
+		directory.parent = parent;
+		directory.nameLength = static_cast<uint32_t>(name.size());
+		directory.nameOffset = mArena.size();
+		directory.mtimeSeconds = dirStat.st_mtim.tv_sec;
+		directory.mtimeNanoseconds = dirStat.st_mtim.tv_nsec;
+		if (!readable)
+			directory.mtimeNanoseconds = UNREADABLE;
+		mArena.append(name);
+		mDirectories.push_back(directory);
+		return static_cast<uint32_t>(mDirectories.size() - 1);
+	}
+
+	/**
+	 * Record a regular file in the new snapshot
+	 *
+	 * @param directory	The index of the directory holding the file, from AddDirectory
+	 * @param name		The name of the file within the directory
+	 * @param inode		The inode number of the file
+	 * @param size		The size of the file
+	 */
+	void AddFile(const uint32_t &directory, const std::string &name, const ino_t &inode, const off_t &size)
+	{
+		FileRecord file;
+		file.directory = directory;
+		file.nameLength = static_cast<uint32_t>(name.size());
+		file.nameOffset = mArena.size();
+		file.inode = inode;
+		file.size = size;
+		mArena.append(name);
+		mFiles.push_back(file);
+	}
+
+	/**
+	 * Write the new snapshot, replacing the old one atomically
+	 *
+	 * @param filename	The snapshot file
+	 * @return			True if the snapshot was saved
+	 */
+	bool Save(const std::string &filename) const
+	{
+		std::string tempFilename(filename + ".tmp");
+		FILE *file = fopen(tempFilename.c_str(), "wb");
+		if (file == NULL)
+			return false;
+
+		Header header;
+		memcpy(header.magic, Magic(), sizeof(header.magic));
+		header.version = VERSION;
+		header.directoryCount = static_cast<uint32_t>(mDirectories.size());
+		header.fileCount = mFiles.size();
+		header.arenaSize = mArena.size();
+		header.snapshotTime = mSnapshotTime;
+
+		bool saved = fwrite(&header, sizeof(header), 1, file) == 1 &&
+					 fwrite(mDirectories.data(), sizeof(DirectoryRecord), mDirectories.size(), file) == mDirectories.size() &&
+					 fwrite(mFiles.data(), sizeof(FileRecord), mFiles.size(), file) == mFiles.size() &&
+					 fwrite(mArena.data(), 1, mArena.size(), file) == mArena.size();
+		saved = (fclose(file) == 0) && saved;
+		if (!saved || rename(tempFilename.c_str(), filename.c_str()) != 0)
+		{
+			remove(tempFilename.c_str());
+			return false;
+		}
+		return true;
+	}
+
+
+private:
+	static constexpr uint32_t VERSION = 2;
+	static constexpr int64_t UNREADABLE = -1;	// In place of the mtime nanoseconds, which are never negative
+
+	// On-disk records; every field is naturally aligned so there is no padding to worry about
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t directoryCount;
+		uint64_t fileCount;
+		uint64_t arenaSize;
+		int64_t snapshotTime;		// When the walk that produced the snapshot started
+	};
+
+	struct DirectoryRecord
+	{
+		uint32_t parent;			// Index of the parent directory, NO_PARENT for the starting path
+		uint32_t nameLength;
+		uint64_t nameOffset;		// Offset of the name in the arena
+		int64_t mtimeSeconds;
+		int64_t mtimeNanoseconds;
+	};
+
+	struct FileRecord
+	{
+		uint32_t directory;			// Index of the directory holding the file
+		uint32_t nameLength;
+		uint64_t nameOffset;		// Offset of the name in the arena
+		uint64_t inode;
+		uint64_t size;
+	};
+
+	// The snapshot being recorded
+	int64_t mSnapshotTime;
+	std::vector<DirectoryRecord> mDirectories;
+	std::vector<FileRecord> mFiles;
+	std::string mArena;
+
+	// The snapshot from the previous run, with the files and subdirectories of each directory grouped together
+	int64_t mOldSnapshotTime;
+	std::vector<DirectoryRecord> mOldDirectories;
+	std::vector<FileRecord> mOldFiles;
+	std::string mOldArena;
+	std::unordered_map<std::string, uint32_t> mOldPaths;
+	std::vector<uint32_t> mOldFileOrder;
+	std::vector<uint32_t> mOldFileStart;
+	std::vector<uint32_t> mOldSubdirectoryOrder;
+	std::vector<uint32_t> mOldSubdirectoryStart;
+
+	static const char* Magic()
+	{
+		return "SSFITRC";
+	}
+
+	/**
+	 * Check that the counts in a snapshot's header add up to the size of the file, so a truncated or corrupt snapshot
+	 * isn't trusted with how much memory to allocate
+	 */
+	static bool SizesFit(const Header &header, const uint64_t &fileSize)
+	{
+		if (fileSize < sizeof(Header))
+			return false;
+		uint64_t remaining = fileSize - sizeof(Header);
+		if (header.directoryCount > remaining / sizeof(DirectoryRecord))
+			return false;
+		remaining -= header.directoryCount * sizeof(DirectoryRecord);
+		if (header.fileCount > remaining / sizeof(FileRecord))
+			return false;
+		remaining -= header.fileCount * sizeof(FileRecord);
+		return header.arenaSize == remaining;
+	}
+
+	/**
+	 * Check the snapshot from the previous run and build the lookup tables for it
+	 *
+	 * @return	True if the snapshot is consistent
+	 */
+	bool IndexOldSnapshot()
+	{
+		// Rebuild the full path of each directory; parents are always recorded before their children
+		std::vector<std::string> paths(mOldDirectories.size());
+		for (size_t i = 0; i < mOldDirectories.size(); ++i)
+		{
+			const DirectoryRecord &directory = mOldDirectories[i];
+			if (directory.nameOffset + directory.nameLength > mOldArena.size())
+				return false;
+			if (directory.parent == NO_PARENT)
+				paths[i].assign(mOldArena, directory.nameOffset, directory.nameLength);
+			else if (directory.parent < i)
+				paths[i] = paths[directory.parent] + "/" + mOldArena.substr(directory.nameOffset, directory.nameLength);
+			else
+				return false;
+			mOldPaths[paths[i]] = static_cast<uint32_t>(i);
+		}
+
+		for (const auto &file : mOldFiles)
+		{
+			if (file.directory >= mOldDirectories.size() || file.nameOffset + file.nameLength > mOldArena.size())
+				return false;
+		}
+
+		GroupBy(mOldFiles, [](const FileRecord &file) { return file.directory; }, mOldFileOrder, mOldFileStart);
+		GroupBy(mOldDirectories, [](const DirectoryRecord &directory) { return directory.parent; }, mOldSubdirectoryOrder, mOldSubdirectoryStart);
+		return true;
+	}
+
+	/**
+	 * Group records by the directory they belong to, as a list of record indexes plus the start of each directory's
+	 * run in that list
+	 */
+	template<typename Record, typename KeyFunction>
+	void GroupBy(const std::vector<Record> &records, KeyFunction key, std::vector<uint32_t> &order, std::vector<uint32_t> &start) const
+	{
+		start.assign(mOldDirectories.size() + 1, 0);
+		for (const auto &record : records)
+		{
+			if (key(record) != NO_PARENT)
+				start[key(record) + 1]++;
+		}
+		for (size_t i = 1; i < start.size(); ++i)
+			start[i] += start[i - 1];
+
+		order.resize(start.back());
+		std::vector<uint32_t> next(start.begin(), start.end() - 1);
+		for (size_t i = 0; i < records.size(); ++i)
+		{
+			if (key(records[i]) != NO_PARENT)
+				order[next[key(records[i])]++] = static_cast<uint32_t>(i);
+		}
+	}
+
+	// No copying
+	TraversalCache(const TraversalCache&);
+	TraversalCache& operator=(const TraversalCache& other);
+
+};
+
+#endif // TRAVERSALCACHE_H
@@ -0,0 +1,100 @@
+#ifndef VOCABULARY_H
+#define VOCABULARY_H
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "PerfectHash.h"
+
+/**
+ * The Vocabulary class is a known list of words, such as the most common words of the text being indexed, laid out with
+ * a PerfectHash so each word has a fixed slot.  A WordAccumulator counts these words in an array by slot instead of in
+ * its general storage.  Words are hashed with std::hash, the same hash WordAccumulator uses, so a word is only hashed
+ * once.  Not thread-safe to load, safe to read from any number of threads
+ */
+class Vocabulary
+{
+public:
+
+	/**
+	 * Vocabulary constructor.  The vocabulary starts out empty
+	 */
+	Vocabulary()
+	{ }
+
+	/**
+	 * Load the words from a file, separated by whitespace.  Words must be written the way the tokenizer produces them
+	 *
+	 * @param path	The file to read
+	 * @return		WordListStatus::Loaded if the words were loaded; otherwise the vocabulary is empty
+	 */
+	WordListStatus Load(const std::string &path)
+	{
+		std::vector<std::string> words;
+		if (!ReadWordList(path, words))
+		{
+			mWords.Clear();
+			return WordListStatus::Unreadable;
+		}
+
+		std::hash<std::string> hasher;
+		std::vector<uint64_t> hashes;
+		hashes.reserve(words.size());
+		for (const auto &word : words)
+			hashes.push_back(hasher(word));
+		return Build(words, hashes);
+	}
+
+	/**
+	 * Lay out a list of distinct words
+	 *
+	 * @param words		The words
+	 * @param hashes	The std::hash of each word
+	 * @return			WordListStatus::Loaded if the words were laid out; otherwise the vocabulary is empty
+	 */
+	WordListStatus Build(const std::vector<std::string> &words, const std::vector<uint64_t> &hashes)
+	{
+		if (!mWords.Build(words, hashes))
+			return WordListStatus::Unhashable;
+		return WordListStatus::Loaded;
+	}
+
+	/**
+	 * Find a word's slot
+	 *
+	 * @param word	The word
+	 * @param hash	The word's std::hash
+	 * @return		The word's slot, or PerfectHash::NOT_FOUND if it isn't in the vocabulary
+	 */
+	size_t Find(const std::string &word, const size_t &hash) const
+	{
+		return mWords.Find(word, hash);
+	}
+
+	/**
+	 * Get the number of words, which is also the number of slots
+	 */
+	size_t Size() const
+	{
+		return mWords.Size();
+	}
+
+	/**
+	 * Get the word in a slot
+	 */
+	const std::string& Word(const size_t &slot) const
+	{
+		return mWords.Word(slot);
+	}
+
+
+private:
+	PerfectHash mWords;
+
+	// No copying
+	Vocabulary(const Vocabulary&);
+	Vocabulary& operator=(const Vocabulary& other);
+
+};
+
+#endif // VOCABULARY_H
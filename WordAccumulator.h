@@ -1,27 +1,124 @@
 #ifndef WORDACCUMULATOR_H
 #define WORDACCUMULATOR_H
 
+#include <algorithm>
+#include <atomic>
 #include <boost/thread/mutex.hpp>
+#include <memory>
+#include <new>
+#include <stdint.h>
+#include <string.h>
 #include <string>
 #include <utility>
 #include <vector>
+#include "LockFreeWordMap.h"
+#include "PageArena.h"
+#include "Vocabulary.h"
 
 using WordCountType = std::pair<std::string, int>;
 
+/**
+ * Where a WordAccumulator keeps its counts
+ */
+enum class WordStore
+{
+	LockedBins,	// Many small bins, each behind its own mutex
+	LockFree	// A LockFreeWordMap
+};
+
 /**
  * The WordAccumulator class is a thread-safe, specialized container for counting the occurance of unique words
  */
 class WordAccumulator
 {
 public:
+	static constexpr size_t MAX_BATCH = 32;	// The most words AddWords takes at once
+
+	/**
+	 * Words collected by one thread to add as a batch, each with its count and hash.  Not thread-safe; one per thread
+	 */
+	class Batch
+	{
+	public:
+
+		Batch()
+			: mSize(0)
+		{ }
+
+		/**
+		 * Count an occurance of a word, adding the batch to the accumulator when it fills up
+		 *
+		 * @param word			The word
+		 * @param accumulator	Where the batch goes
+		 */
+		void AddWord(const std::string &word, WordAccumulator &accumulator)
+		{
+			AddWord(word, 1, accumulator.Hash(word), accumulator);
+		}
+
+		/**
+		 * Count several occurances of a word whose hash is already known, adding the batch to the accumulator when it
+		 * fills up
+		 *
+		 * @param word			The word
+		 * @param count			The number of occurances
+		 * @param hash			The word's hash, from the accumulator's Hash
+		 * @param accumulator	Where the batch goes
+		 */
+		void AddWord(const std::string &word, const int &count, const size_t &hash, WordAccumulator &accumulator)
+		{
+			mWords[mSize] = word;
+			mCounts[mSize] = count;
+			mHashes[mSize] = hash;
+			if (++mSize == MAX_BATCH)
+				Flush(accumulator);
+		}
+
+		/**
+		 * Add the words collected so far to the accumulator
+		 *
+		 * @param accumulator	Where the words go
+		 */
+		void Flush(WordAccumulator &accumulator)
+		{
+			accumulator.AddWords(mWords, mCounts, mHashes, mSize);
+			mSize = 0;
+		}
+
+	private:
+		std::string mWords[MAX_BATCH];	// Reused, so words usually fit without allocating
+		int mCounts[MAX_BATCH];
+		size_t mHashes[MAX_BATCH];
+		size_t mSize;
+
+		// No copying
+		Batch(const Batch&);
+		Batch& operator=(const Batch& other);
+	};
 
 	/**
 	 * WordAccumulator constructor
+	 *
+	 * @param store		Where to keep the counts
+	 * @param vocabulary	Words to count in fixed slots ahead of the store, NULL for none.  Must outlive the accumulator
+	 * @param hugePages		The pages to keep the word tables in
 	 */
-	WordAccumulator()
-		: mBins(BIN_COUNT),
-		  mBinMutexes(BIN_COUNT)
-	{ }
+	WordAccumulator(const WordStore &store = WordStore::LockedBins,
+					const Vocabulary* vocabulary = NULL,
+					const HugePageMode &hugePages = HugePageMode::Off)
+		: mStore(store),
+		  mArena(hugePages),
+		  mBins(store == WordStore::LockedBins ? BIN_COUNT : 0),
+		  mVocabulary(vocabulary)
+	{
+		if (mStore == WordStore::LockFree)
+			mLockFreeWords.reset(new LockFreeWordMap(hugePages));
+		if (mVocabulary != NULL)
+		{
+			mVocabularyCounts.reset(new std::atomic<int>[mVocabulary->Size()]);
+			ClearVocabularyCounts();
+		}
+	}
 
 	/**
 	 * Add a word.  If the word already exists, its count will be incremented
@@ -30,24 +127,131 @@ public:
 	 */
 	void AddWord(const std::string &word)
 	{
+		AddWord(word, 1);
+	}
+
+	/**
+	 * Add several occurances of a word at once
+	 * 
+	 * @param word	The word to add
+	 * @param count	The number of occurances
+	 */
+	void AddWord(const std::string &word, const int &count)
+	{
+		AddWord(word, count, Hash(word));
+	}
+
+	/**
+	 * Add several occurances of a word whose hash is already known
+	 * 
+	 * @param word	The word to add
+	 * @param count	The number of occurances
+	 * @param hash	The word's hash, from Hash
+	 */
+	void AddWord(const std::string &word, const int &count, const size_t &hash)
+	{
+		// Vocabulary words have a counter of their own, so they need neither a search nor a lock
+		if (mVocabulary != NULL)
+		{
+			size_t slot = mVocabulary->Find(word, hash);
+			if (slot != PerfectHash::NOT_FOUND)
+			{
+				mVocabularyCounts[slot].fetch_add(count, std::memory_order_relaxed);
+				return;
+			}
+		}
+
+		if (mStore == WordStore::LockFree)
+		{
+			mLockFreeWords->AddWord(word, count, hash);
+			return;
+		}
+
 		// Figure out which bin the word goes in and lock it
-		size_t binIndex = mHasher(word) % mBins.size();
-		boost::mutex::scoped_lock lock(mBinMutexes[binIndex]);
+		Bin &bin = mBins[hash & (BIN_COUNT - 1)];
+		boost::mutex::scoped_lock lock(bin.mutex);
+		if ((bin.size + 1) * 4 > bin.capacity.load(std::memory_order_relaxed) * 3)
+			bin.Grow(mArena);
 
-		// See if the word is already present in the bin and increment it if so
-		// I'm not terribly fond of this linear search, but I tested other approaches (like using a map for each bin instead of a vector for each bin)
-		// and this was the fastest, probably because the large number of bins causes a low number of unique words per bin
-		for (auto &wordPair : mBins[binIndex])
+		// Find the word, or the empty slot it goes in.  The bin's table is indexed by the hash bits above the ones that
+		// chose the bin
+		Entry key(word, hash);
+		bool packed = (word.size() <= Entry::INLINE_LENGTH);
+		Entry *slots = bin.slots.load(std::memory_order_relaxed);
+		size_t mask = bin.capacity.load(std::memory_order_relaxed) - 1;
+		for (size_t i = (hash >> BIN_BITS) & mask; ; i = (i + 1) & mask)
 		{
-			if (wordPair.first == word)
+			Entry &entry = slots[i];
+			if (entry.length == Entry::EMPTY)
 			{
-				wordPair.second++;
+				if (!packed)
+				{
+					key.parts[0] = bin.spill.size();
+					bin.spill.append(word);
+				}
+				key.count = count;
+				entry = key;
+				bin.size++;
+				return;
+			}
+			if (entry.hash == hash && entry.length == key.length &&
+				(packed ? entry.SameInline(key) : memcmp(bin.spill.data() + entry.parts[0], word.data(), word.size()) == 0))
+			{
+				entry.count += count;
 				return;
 			}
 		}
+	}
 
-		// Add the word if it was not found
-		mBins[binIndex].emplace_back(word, 1);
+	/**
+	 * Add several words, each with its count and hash.  Looking a word up usually misses the CPU cache twice, once for
+	 * its bin and once for the slot in the bin's table, so the whole batch has its bins prefetched, then their slots,
+	 * before any word is looked up, and the misses overlap instead of being waited on one at a time.  The slots are
+	 * prefetched without the bin's lock, so a table being replaced at the same time may get a useless prefetch, but
+	 * never a wrong count
+	 * 
+	 * @param words		The words to add
+	 * @param counts	The number of occurances of each word
+	 * @param hashes	The hash of each word, from Hash
+	 * @param count		The number of words, at most MAX_BATCH
+	 */
+	void AddWords(const std::string *words, const int *counts, const size_t *hashes, const size_t &count)
+	{
+		if (mStore == WordStore::LockFree)
+		{
+			for (size_t i = 0; i < count; ++i)
+				mLockFreeWords->Prefetch(hashes[i]);
+		}
+		else
+		{
+			for (size_t i = 0; i < count; ++i)
+				__builtin_prefetch(&mBins[hashes[i] & (BIN_COUNT - 1)], 1);
+			for (size_t i = 0; i < count; ++i)
+			{
+				// The table and its size may come from either side of a Grow, so the address is worked out as an integer
+				// rather than indexing a table that might be smaller; a prefetch of a bad address is simply dropped
+				const Bin &bin = mBins[hashes[i] & (BIN_COUNT - 1)];
+				uintptr_t slots = reinterpret_cast<uintptr_t>(bin.slots.load(std::memory_order_relaxed));
+				size_t capacity = bin.capacity.load(std::memory_order_relaxed);
+				if (slots != 0 && capacity > 0)
+					__builtin_prefetch(reinterpret_cast<const void*>(slots + ((hashes[i] >> BIN_BITS) & (capacity - 1)) * sizeof(Entry)));
+			}
+		}
+
+		for (size_t i = 0; i < count; ++i)
+			AddWord(words[i], counts[i], hashes[i]);
+	}
+
+	/**
+	 * Hash a word the way this container does, for callers that want to hash once and use the hash for their own
+	 * purposes too
+	 * 
+	 * @param word	The word
+	 * @return		The hash
+	 */
+	size_t Hash(const std::string &word) const
+	{
+		return mHasher(word);
 	}
 
 	/**
@@ -55,21 +259,34 @@ public:
 	 */
 	void ClearResults()
 	{
+		if (mVocabulary != NULL)
+			ClearVocabularyCounts();
+
+		if (mStore == WordStore::LockFree)
+		{
+			mLockFreeWords->Clear();
+			return;
+		}
+
 		// To atomically clear we need to lock all of the bins, clear each bin, then unlock them all
 
 		// Lock every bin
-		for (auto &mutex : mBinMutexes)
-			mutex.lock();
+		for (auto &bin : mBins)
+			bin.mutex.lock();
 
-		// Clear each bin
+		// Clear each bin, letting its table start small again
 		for(auto &bin : mBins)
 		{
-			bin.clear();
+			bin.slots.store(NULL, std::memory_order_relaxed);
+			bin.capacity.store(0, std::memory_order_relaxed);
+			bin.size = 0;
+			bin.spill.clear();
 		}
+		mArena.Reset();
 
 		// Unlock every bin
-		for (auto &mutex : mBinMutexes)
-			mutex.unlock();
+		for (auto &bin : mBins)
+			bin.mutex.unlock();
 	}
 
 	/**
@@ -80,15 +297,45 @@ public:
 	 */
 	std::vector<WordCountType> ListTopWords(const int &count) const
 	{
+		std::vector<WordCountType> allWords = ListAllWords();
+		if (allWords.size() <= 0)
+			return allWords;
+
+		// Sort by occurance and return the requested slice
+		sort(allWords.begin(),
+			 allWords.end(),
+			 [](const std::pair<std::string, int>& a, const std::pair<std::string, int>& b)
+			 {
+				 return a.second > b.second;
+			 });
+		return std::vector<WordCountType>(allWords.begin(), allWords.begin() + std::min(static_cast<size_t>(count), allWords.size()));
+	}
+
+	/**
+	 * Get a consistent snapshot of every word and its count
+	 * 
+	 * @return	A vector of WordCountType with every word, in no particular order
+	 */
+	std::vector<WordCountType> ListAllWords() const
+	{
+		// The lock-free map can't take a consistent snapshot while words are being added, but checkpoints hold off
+		// commits before listing words
+		if (mStore == WordStore::LockFree)
+		{
+			std::vector<WordCountType> allWords = mLockFreeWords->ListAllWords();
+			ListVocabularyWords(allWords);
+			return allWords;
+		}
+
 		// Lock every bin
-		for (auto &mutex : mBinMutexes)
-			mutex.lock();
+		for (auto &bin : mBins)
+			bin.mutex.lock();
 
 		// Count total the number of words and preallocate
 		size_t totalWords = 0;
 		for(const auto &bin : mBins)
 		{
-			totalWords += bin.size();
+			totalWords += bin.size;
 		}
 		std::vector<WordCountType> allWords;
 		allWords.reserve(totalWords);
@@ -96,26 +343,21 @@ public:
 		// Make a list of all the words from all the bins
 		for(const auto &bin : mBins)
 		{
-			if (bin.size() <= 0)
-				continue;
-			allWords.insert(allWords.end(), bin.begin(), bin.end());
+			const Entry *slots = bin.slots.load(std::memory_order_relaxed);
+			size_t capacity = bin.capacity.load(std::memory_order_relaxed);
+			for (size_t i = 0; i < capacity; ++i)
+			{
+				if (slots[i].length != Entry::EMPTY)
+					allWords.emplace_back(slots[i].Word(bin.spill), slots[i].count);
+			}
 		}
 
 		// Unlock every bin
-		for (auto &mutex : mBinMutexes)
-			mutex.unlock();
+		for (auto &bin : mBins)
+			bin.mutex.unlock();
 
-		if (allWords.size() <= 0)
-			return allWords;
-
-		// Sort by occurance and return the requested slice
-		sort(allWords.begin(),
-			 allWords.end(),
-			 [](const std::pair<std::string, int>& a, const std::pair<std::string, int>& b)
-			 {
-				 return a.second > b.second;
-			 });
-		return std::vector<WordCountType>(allWords.begin(), allWords.begin() + count);
+		ListVocabularyWords(allWords);
+		return allWords;
 	}
 
 	/**
@@ -125,30 +367,173 @@ public:
 	 */
 	size_t GetUniqueWordCount() const
 	{
+		if (mStore == WordStore::LockFree)
+			return mLockFreeWords->GetUniqueWordCount() + CountVocabularyWords();
+
 		// Lock every bin
-		for (auto &mutex : mBinMutexes)
-			mutex.lock();
+		for (auto &bin : mBins)
+			bin.mutex.lock();
 
 		// Count the words in each bin
 		size_t totalWords = 0;
 		for(const auto &bin : mBins)
 		{
-			totalWords += bin.size();
+			totalWords += bin.size;
 		}
 
 		// Unlock every bin
-		for (auto &mutex : mBinMutexes)
-			mutex.unlock();
+		for (auto &bin : mBins)
+			bin.mutex.unlock();
 
-		return totalWords;
+		return totalWords + CountVocabularyWords();
 	}
 
 
 private:
-	static const size_t BIN_COUNT = 32767;  // Large number of bins to minimize lock contention and to keep the number of words per bin low
-	std::vector<std::vector<WordCountType> > mBins;
-	mutable std::vector<boost::mutex> mBinMutexes;
+	// Enough bins that threads rarely want the same lock.  That depends on the number of threads rather than words; each
+	// bin's table grows with the words in it, so the bins stay fast however many words there are
+	static constexpr size_t BIN_BITS = 10;
+	static constexpr size_t BIN_COUNT = 1 << BIN_BITS;
+	static constexpr size_t INITIAL_SLOTS = 8;	// The size of a bin's table once it has a word; must be a power of two
+
+	/**
+	 * A word and its count.  Words of up to INLINE_LENGTH bytes are packed into the entry itself, zero padded, so
+	 * comparing two of them is a length compare and two integer compares.  Longer words are kept in their bin's spill
+	 * text and the entry holds where they start.  The hash is kept so most mismatches and every regrowth skip the word
+	 */
+	struct Entry
+	{
+		static constexpr size_t INLINE_LENGTH = 2 * sizeof(uint64_t);
+		static constexpr uint32_t EMPTY = 0xFFFFFFFF;	// The length of an empty slot
+
+		Entry()
+			: parts(),
+			  hash(0),
+			  length(EMPTY),
+			  count(0)
+		{ }
+
+		/**
+		 * Pack a word.  A long word's start has to be filled in by the bin it's added to
+		 */
+		Entry(const std::string &word, const size_t &hash)
+			: parts(),
+			  hash(hash),
+			  length(static_cast<uint32_t>(word.size())),
+			  count(0)
+		{
+			if (word.size() <= INLINE_LENGTH)
+				memcpy(parts, word.data(), word.size());
+		}
+
+		bool SameInline(const Entry &other) const
+		{
+			return length == other.length && parts[0] == other.parts[0] && parts[1] == other.parts[1];
+		}
+
+		std::string Word(const std::string &spill) const
+		{
+			if (length <= INLINE_LENGTH)
+				return std::string(reinterpret_cast<const char*>(parts), length);
+			return spill.substr(parts[0], length);
+		}
+
+		uint64_t parts[2];	// The word's bytes, or its start in the spill text
+		size_t hash;
+		uint32_t length;	// EMPTY for an empty slot
+		int count;
+	};
+	static_assert((sizeof(Entry) & (sizeof(Entry) - 1)) == 0, "bin tables are power of two blocks from the arena");
+
+	/**
+	 * An open addressing table of words behind a lock of its own.  It starts empty and doubles as it fills, holding only
+	 * its own lock while it does.  The tables are allocated from the accumulator's arena.  The table and its size are
+	 * atomic only so AddWords can prefetch without the lock; everything else reads them under it
+	 */
+	struct Bin
+	{
+		Bin()
+			: slots(NULL),
+			  capacity(0),
+			  size(0)
+		{ }
+
+		mutable boost::mutex mutex;
+		std::atomic<Entry*> slots;			// NULL until the first word
+		std::atomic<size_t> capacity;		// The number of slots, a power of two
+		size_t size;						// The number of words
+		std::string spill;					// The words too long to pack, back to back
+
+		void Grow(PageArena &arena)
+		{
+			Entry *old = slots.load(std::memory_order_relaxed);
+			size_t oldCapacity = capacity.load(std::memory_order_relaxed);
+			size_t newCapacity = std::max(oldCapacity * 2, INITIAL_SLOTS);
+			Entry *table = static_cast<Entry*>(arena.Allocate(newCapacity * sizeof(Entry)));
+			for (size_t i = 0; i < newCapacity; ++i)
+				new (&table[i]) Entry();
+
+			size_t mask = newCapacity - 1;
+			for (size_t j = 0; j < oldCapacity; ++j)
+			{
+				if (old[j].length == Entry::EMPTY)
+					continue;
+				size_t i = (old[j].hash >> BIN_BITS) & mask;
+				while (table[i].length != Entry::EMPTY)
+					i = (i + 1) & mask;
+				table[i] = old[j];
+			}
+			capacity.store(newCapacity, std::memory_order_relaxed);
+			slots.store(table, std::memory_order_release);
+			if (old != NULL)
+				arena.Free(old, oldCapacity * sizeof(Entry));
+		}
+	};
+
+	WordStore mStore;
+	PageArena mArena;			// Holds the bins' tables
+	std::vector<Bin> mBins;
 	std::hash<std::string> mHasher;
+	std::unique_ptr<LockFreeWordMap> mLockFreeWords;	// Only made for WordStore::LockFree, instead of the bins; reading it helps finish a resize
+	const Vocabulary* mVocabulary;
+	std::unique_ptr<std::atomic<int>[]> mVocabularyCounts;	// Indexed by vocabulary slot
+
+	void ClearVocabularyCounts()
+	{
+		for (size_t slot = 0; slot < mVocabulary->Size(); ++slot)
+			mVocabularyCounts[slot].store(0, std::memory_order_relaxed);
+	}
+
+	/**
+	 * Add the vocabulary words that have been found to a list of words
+	 */
+	void ListVocabularyWords(std::vector<WordCountType> &allWords) const
+	{
+		if (mVocabulary == NULL)
+			return;
+		for (size_t slot = 0; slot < mVocabulary->Size(); ++slot)
+		{
+			int count = mVocabularyCounts[slot].load(std::memory_order_relaxed);
+			if (count > 0)
+				allWords.emplace_back(mVocabulary->Word(slot), count);
+		}
+	}
+
+	/**
+	 * Get the number of vocabulary words that have been found
+	 */
+	size_t CountVocabularyWords() const
+	{
+		if (mVocabulary == NULL)
+			return 0;
+		size_t found = 0;
+		for (size_t slot = 0; slot < mVocabulary->Size(); ++slot)
+		{
+			if (mVocabularyCounts[slot].load(std::memory_order_relaxed) > 0)
+				found++;
+		}
+		return found;
+	}
 
 	// No copying
 	WordAccumulator(const WordAccumulator&);
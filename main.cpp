@@ -1,19 +1,130 @@
-#include <assert.h>
 #include <boost/asio/io_service.hpp>
 #include <boost/make_shared.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/shared_mutex.hpp>
 #include <boost/thread/thread.hpp>
+#include <chrono>
+#include <cmath>
 #include <dirent.h>
-#include <fstream>
 #include <iomanip>
+#include <linux/ioprio.h>
+#include <memory>
+#include <pthread.h>
+#include <sched.h>
 #include <string>
 #include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
+#include "AlignedBufferPool.h"
+#include "Checkpoint.h"
+#include "CpuDutyCycle.h"
+#include "CrawlStats.h"
+#include "DictionaryWordCounter.h"
+#include "DirectoryWalker.h"
+#include "FileEntry.h"
+#include "FileListReader.h"
+#include "FileOrderer.h"
+#include "FileReader.h"
+#include "FileSampler.h"
+#include "HotWordCache.h"
+#include "HugePages.h"
+#include "NumaNodes.h"
+#include "PageCacheProbe.h"
+#include "PartitionedWordCounter.h"
 #include "ProgramOptions.h"
+#include "RateLimiter.h"
+#include "ReadaheadWindow.h"
+#include "SampleEstimator.h"
+#include "StopWords.h"
+#include "TokenFilter.h"
+#include "Tokenizer.h"
+#include "TokenizerPolicies.h"
+#include "TraversalCache.h"
+#include "Vocabulary.h"
 #include "WordAccumulator.h"
 using namespace std;
 
 
+/**
+ * Tunable settings for a FileIndexer
+ */
+struct FileIndexerSettings
+{
+	FileIndexerSettings()
+		: fileProcessingThreads(3),
+		  order(FileOrder::Readdir),
+		  orderBatchSize(1024),
+		  readaheadDepth(0),
+		  dropCache(false),
+		  ioThreads(0),
+		  directIO(false),
+		  directQueueDepth(4),
+		  maxBytesPerSecond(0),
+		  maxFilesPerSecond(0),
+		  ioPriorityClass(IOPRIO_CLASS_NONE),
+		  ioPriorityLevel(IOPRIO_NORM),
+		  cpuDutyPercent(100),
+		  traversalOrder(TraversalOrder::DepthFirst),
+		  maxOpenDirectories(64),
+		  fileListDelimiter('\n'),
+		  checkpointInterval(60),
+		  resume(false),
+		  timeBudget(0),
+		  byteBudget(0),
+		  sampleFiles(0),
+		  sampleTopWords(10),
+		  sampleTolerance(0.05),
+		  aggregatorThreads(0),
+		  wordStore(WordStore::LockedBins),
+		  dictionary(false),
+		  vocabulary(NULL),
+		  hugePages(HugePageMode::Off),
+		  numa(false),
+		  wordRules(WordRules::Unicode),
+		  stopWords(NULL)
+	{ }
+
+	int fileProcessingThreads;	// The number of threads to use for processing files
+	FileOrder order;			// The order to hand found files to the processing threads in
+	size_t orderBatchSize;		// The number of found files to collect and sort at a time when order is not Readdir
+	size_t readaheadDepth;		// The number of queued files to ask the kernel to read ahead, 0 to disable
+	bool dropCache;				// Drop each file from the page cache after it has been processed
+	int ioThreads;				// The number of threads for files that are not in the page cache, 0 to treat all files alike
+	bool directIO;				// Read files with O_DIRECT, bypassing the page cache
+	size_t directQueueDepth;	// The number of O_DIRECT reads to keep in flight per file
+	double maxBytesPerSecond;	// Limit on the rate files are read at, 0 for no limit
+	double maxFilesPerSecond;	// Limit on the rate files are opened at, 0 for no limit
+	int ioPriorityClass;		// The I/O scheduling class for the search and processing threads, IOPRIO_CLASS_NONE to leave it alone
+	int ioPriorityLevel;		// The priority within the best-effort class, 0 (highest) to 7 (lowest)
+	int cpuDutyPercent;			// The share of a CPU each processing thread may use, 100 for no limit
+	TraversalOrder traversalOrder;	// The order to search directories in
+	size_t maxOpenDirectories;	// The most directories to hold open at once during the search
+	string fileListPath;		// Read the files to process from this list instead of searching, "-" for stdin
+	string traversalCachePath;	// Reuse and update the search snapshot in this file, empty to always search everything
+	char fileListDelimiter;		// The character between paths in the list
+	string checkpointPath;		// Periodically save progress to this file, empty to disable
+	string countingOptions;		// The options that decide what is counted, saved with checkpoints and checked on resume
+	int checkpointInterval;		// Seconds between checkpoints
+	bool resume;				// Continue from the checkpoint in checkpointPath instead of starting over
+	double timeBudget;			// Stop after this many seconds and report what was counted so far, 0 for no limit
+	uint64_t byteBudget;		// Stop after reading this many bytes and report what was counted so far, 0 for no limit
+	size_t sampleFiles;			// Process a random sample of this many of the files found and extrapolate, 0 to process them all
+	size_t sampleTopWords;		// The number of top words to estimate when sampling
+	double sampleTolerance;		// Stop sampling once the top words are stable with intervals within this fraction of their counts
+	int aggregatorThreads;		// The number of threads that each own a partition of the word counts, 0 to use shared counts with locks
+	WordStore wordStore;		// How the shared word counts are kept when there are no aggregator threads
+	bool dictionary;			// Count words by dense ID in per-thread arrays instead of in the shared counts
+	const Vocabulary* vocabulary;	// Known words the shared counts keep in fixed slots, NULL for none
+	HugePageMode hugePages;		// The pages to keep the word tables in
+	bool numa;					// Pin processing threads to NUMA nodes and count in per-node word counts, merged at the end
+	WordRules wordRules;		// How to split text into words
+	TokenFilter tokenFilter;	// Rules for leaving words out by length and shape
+	const StopWords* stopWords;	// Words to leave out of the counts, NULL to count every word
+};
+
 /**
  * Recursively find and index text files under a given path
  */
@@ -24,39 +135,174 @@ public:
 	/**
 	 * FileIndexer Constructor
 	 * 
-	 * @param basePath					The starting path to search
-	 * @param fileProcessingThreads		The number of threads to use for processing files
-	 * @param timingInfo				Collect info about lock timing
+	 * @param basePath		The starting path to search
+	 * @param settings		Threading and scheduling settings
 	 */
-	FileIndexer(const string& basePath, const int& fileProcessingThreads = 3)
+	FileIndexer(const string& basePath, const FileIndexerSettings& settings = FileIndexerSettings())
 		: mBasePath(basePath),
-		  mFileProcessingThreads(fileProcessingThreads),
-		  mWordsFound()
-	{ }
+		  mSettings(settings),
+		  mWordsFound(settings.wordStore, settings.vocabulary, settings.hugePages),
+		  mPartitionedWords(settings.aggregatorThreads),
+		  mOrderer(settings.order, settings.orderBatchSize),
+		  mReadahead(settings.readaheadDepth),
+		  mDirectBuffers(FileReader::DIRECT_BUFFER_SIZE, FileReader::DIRECT_ALIGNMENT),
+		  mByteLimiter(settings.maxBytesPerSecond, settings.maxBytesPerSecond / 10),
+		  mFileLimiter(settings.maxFilesPerSecond, max(1.0, settings.maxFilesPerSecond / 10)),
+		  mSearchComplete(false),
+		  mStopCheckpoints(false),
+		  mSampler(settings.sampleFiles),
+		  mEstimator(settings.sampleTopWords, settings.sampleTolerance),
+		  mStopReason(StopReason::None),
+		  mBudgetBytes(0),
+		  mNextWorkerNode(0)
+	{
+		// The per-thread word caches take work off the shared word counts' locks, which only pays when threads are
+		// contending for them.  On their own the lookups cost about as much as the uncontended locks they replace
+		int threads = settings.fileProcessingThreads + settings.ioThreads;
+		int cores = boost::thread::hardware_concurrency();
+		mUseWordCache = (threads > 1 && cores != 1 && !Partitioned() && !mSettings.dictionary);
+
+		if (settings.numa)
+		{
+			mNumaNodes = ReadNumaNodes();
+			if (mNumaNodes.empty())
+				cout << "Failed to find the NUMA nodes, counting words in one place" << endl;
+		}
+
+		mReaderSettings.dropCache = settings.dropCache;
+		if (settings.directIO)
+		{
+			mReaderSettings.directBuffers = &mDirectBuffers;
+			mReaderSettings.directQueueDepth = settings.directQueueDepth;
+		}
+
+		// Pick the file processing loop compiled for the chosen word rules, so nothing has to be decided per byte
+		switch (settings.wordRules)
+		{
+		case WordRules::Ascii:
+			mProcessFile = &FileIndexer::ProcessFile<AsciiPolicy>;
+			break;
+		case WordRules::Code:
+			mProcessFile = &FileIndexer::ProcessFile<CodePolicy>;
+			break;
+		case WordRules::Hyphenated:
+			mProcessFile = &FileIndexer::ProcessFile<HyphenatedPolicy>;
+			break;
+		case WordRules::CaseSensitive:
+			mProcessFile = &FileIndexer::ProcessFile<CaseSensitivePolicy>;
+			break;
+		default:
+			mProcessFile = &FileIndexer::ProcessFile<UnicodePolicy>;
+			break;
+		}
+	}
 
 	/**
 	 * Run the search/index
+	 *
+	 * @return	False if the checkpoint to resume from can't be used with these settings, in which case nothing is run
 	 */
-	void Run()
+	bool Run()
 	{
+		mWordsFound.ClearResults();
+		vector<string> pendingFiles;
+		bool searchComplete = false;
+		if (mSettings.resume && !RestoreCheckpoint(pendingFiles, searchComplete))
+			return false;
+
 		boost::thread_group workerThreads;
+		boost::thread checkpointThread;
+		mDeadline = chrono::steady_clock::now() + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(mSettings.timeBudget));
 		{
 			
-			// Setup thread pool
+			// Setup thread pools.  Files that are already in the page cache go straight to the processing threads, the
+			// rest wait their turn on the I/O threads so they don't hold up the cached ones
 			boost::asio::io_service::work work(mIOService);
-			for (int i = 0; i < mFileProcessingThreads; ++i)
+			boost::asio::io_service::work coldWork(mColdIOService);
+			mNodeWords.resize(mNumaNodes.size());
+			for (int i = 0; i < mSettings.fileProcessingThreads; ++i)
+			{
+				workerThreads.create_thread(boost::bind(&FileIndexer::WorkerThread, this, &mIOService));
+			}
+			for (int i = 0; i < mSettings.ioThreads; ++i)
 			{
-				workerThreads.create_thread(boost::bind(&boost::asio::io_service::run, &mIOService));
+				workerThreads.create_thread(boost::bind(&FileIndexer::WorkerThread, this, &mColdIOService));
 			}
 
 			// Use the main thread to run the search, which will post work items to the io_service
-			mWordsFound.ClearResults();
-			SearchForFiles(mBasePath);
+			SetIoPriority();
+			if (Partitioned())
+				mPartitionedWords.Start();
+			if (mSettings.dictionary)
+				mDictionaryWords.ClearResults();
+			if (Checkpointing())
+				checkpointThread = boost::thread(&FileIndexer::CheckpointThread, this);
+
+			if (searchComplete)
+			{
+				// The interrupted run had found every file, so only the ones it didn't finish are left to do
+				for (size_t i = 0; i < pendingFiles.size() && !Cancelled(); ++i)
+					DispatchPath(pendingFiles[i]);
+			}
+			else if (mSettings.fileListPath.empty())
+				SearchForFiles(mBasePath);
+			else
+				ReadFileList(mSettings.fileListPath);
+			if (mSettings.order != FileOrder::Readdir)
+				PostFiles(mOrderer.TakeBatch());
+			if (Sampling())
+			{
+				// The sample is in random order, so it is processed as is; any prefix of it is a sample too, should
+				// sampling converge before the end
+				mEstimator.SetPopulation(mSampler.GetFilesFound());
+				PostFiles(mSampler.TakeSample());
+			}
+			if (Checkpointing())
+			{
+				// A search cut short by a budget has to be run again on resume
+				boost::mutex::scoped_lock lock(mFilesMutex);
+				mSearchComplete = !Cancelled();
+			}
 		}
 		// Wait for all of the work items to complete
 		workerThreads.join_all();
+		if (Numa())
+			MergeNodeWords();
 
-		cout << mWordsFound.GetUniqueWordCount() << " words found" << endl;
+		// Stop the periodic checkpoints and save the final one
+		if (Checkpointing())
+		{
+			{
+				boost::mutex::scoped_lock lock(mCheckpointMutex);
+				mStopCheckpoints = true;
+			}
+			mCheckpointCondition.notify_all();
+			checkpointThread.join();
+			SaveCheckpoint();
+		}
+
+		if (Partitioned())
+			mPartitionedWords.Finish();
+
+		cout << GetUniqueWordCount() << " words found" << endl;
+		cout << mStats.filesProcessed << " files processed, " << mStats.bytesRead << " bytes read, "
+			 << mStats.bytesSkipped << " bytes of sparse file holes skipped" << endl;
+		if (Sampling())
+			cout << "Sampled " << mEstimator.GetFilesSampled() << " of " << mSampler.GetFilesFound() << " files found" << endl;
+		if (mStopReason == StopReason::Converged)
+		{
+			cout << "Stopped sampling early, the top words converged" << endl;
+		}
+		else if (mStopReason != StopReason::None)
+		{
+			// Holes hold no words, so they are left out of the bytes there were to read rather than counted as covered
+			uint64_t dataFound = mStats.bytesFound - min<uint64_t>(mStats.bytesSkipped, mStats.bytesFound);
+			double percent = (dataFound > 0 ? min(100.0, 100.0 * mStats.bytesRead / dataFound) : 100.0);
+			cout << "Stopped early by the " << (mStopReason == StopReason::ByteBudget ? "byte" : "time") << " budget; results cover "
+				 << fixed << setprecision(1) << percent << "% of the " << dataFound << " bytes of data found" << endl;
+			cout.unsetf(ios_base::floatfield);
+		}
+		return true;
 	}
 
 	/**
@@ -67,145 +313,662 @@ public:
 	 */
 	vector<WordCountType> ListTopWords(const int& count) const
 	{
+		if (Partitioned())
+			return mPartitionedWords.ListTopWords(count);
+		if (mSettings.dictionary)
+			return mDictionaryWords.ListTopWords(count);
 		return mWordsFound.ListTopWords(count);
 	}
 
+	/**
+	 * Get the number of unique words found
+	 */
+	size_t GetUniqueWordCount() const
+	{
+		if (Partitioned())
+			return mPartitionedWords.GetUniqueWordCount();
+		if (mSettings.dictionary)
+			return mDictionaryWords.GetUniqueWordCount();
+		if (Sampling())
+			return mEstimator.GetUniqueWordCount();
+		return mWordsFound.GetUniqueWordCount();
+	}
+
+	/**
+	 * Get the extrapolated counts of the top words, when sampling
+	 * 
+	 * @return		Up to sampleTopWords estimates, sorted from highest count to lowest
+	 */
+	vector<WordEstimate> ListTopEstimates() const
+	{
+		return mEstimator.ListTopEstimates();
+	}
+
 
 private:
 	string mBasePath;
-	int mFileProcessingThreads;
+	FileIndexerSettings mSettings;
 	WordAccumulator mWordsFound;
+	PartitionedWordCounter mPartitionedWords;	// Counts words instead of mWordsFound when there are aggregator threads
+	DictionaryWordCounter mDictionaryWords;		// Counts words instead of mWordsFound in dictionary mode
+	FileOrderer mOrderer;
+	ReadaheadWindow mReadahead;
+	PageCacheProbe mCacheProbe;
+	AlignedBufferPool mDirectBuffers;
+	FileReaderSettings mReaderSettings;
+	RateLimiter mByteLimiter;
+	RateLimiter mFileLimiter;
+	CrawlStats mStats;
 	boost::asio::io_service mIOService;
+	boost::asio::io_service mColdIOService;
+	void (FileIndexer::*mProcessFile)(const string&, const uint64_t&);	// ProcessFile for the chosen word rules
+	bool mUseWordCache;		// Count common words in per-thread caches, flushed to mWordsFound when each thread finishes
+
+	// Checkpoint state.  Files commit their words under a shared lock on mCommitMutex and a checkpoint takes it
+	// exclusively, so a checkpoint only ever holds whole files
+	boost::shared_mutex mCommitMutex;
+	boost::mutex mFilesMutex;
+	unordered_set<string> mCompletedFiles;	// Guarded by mFilesMutex
+	unordered_set<string> mPendingFiles;	// Guarded by mFilesMutex
+	bool mSearchComplete;					// Guarded by mFilesMutex
+	boost::mutex mCheckpointMutex;
+	boost::condition_variable mCheckpointCondition;
+	bool mStopCheckpoints;					// Guarded by mCheckpointMutex
+
+	// Sampling state
+	FileSampler mSampler;
+	SampleEstimator mEstimator;
+
+	// Why the run is stopping early.  Once it is set the search stops finding files, and the processing threads stop
+	// reading and drop whatever is still queued
+	enum class StopReason
+	{
+		None,
+		TimeBudget,
+		ByteBudget,
+		Converged	// Sampling has pinned down the top words
+	};
+	atomic<StopReason> mStopReason;
+	atomic<uint64_t> mBudgetBytes;			// Bytes read so far, updated per block rather than per file
+
+	// NUMA mode.  Each node's processing threads count in word counts of their own, created by the first of them so the
+	// memory is on that node, and merged into mWordsFound when the threads are done
+	vector<vector<int> > mNumaNodes;					// The CPUs of each node, empty when not in NUMA mode
+	vector<unique_ptr<WordAccumulator> > mNodeWords;	// One per node; guarded by mNodeWordsMutex while the threads start
+	boost::mutex mNodeWordsMutex;
+	atomic<size_t> mNextWorkerNode;
+	chrono::steady_clock::time_point mDeadline;
 
 	// No copying
 	FileIndexer(const FileIndexer&);
 	FileIndexer& operator=(const FileIndexer& other);
 
+	/**
+	 * Body of a file processing thread
+	 * 
+	 * @param service	The threadpool to serve
+	 */
+	void WorkerThread(boost::asio::io_service* service)
+	{
+		SetIoPriority();
+		if (Numa())
+			JoinNode(mNextWorkerNode++ % mNumaNodes.size());
+		service->run();
+		WordAccumulator &words = ThreadWords();
+		if (mUseWordCache)
+			ThreadWordCache().Flush(words, ThreadWordBatch());
+		else
+			ThreadWordBatch().Flush(words);
+		if (Partitioned())
+			ThreadPartitionWriter().Flush(mPartitionedWords);
+		if (mSettings.dictionary)
+			ThreadDictionaryWriter().Flush(mDictionaryWords);
+	}
+
+	/**
+	 * Get the calling thread's cache of common words
+	 */
+	static HotWordCache& ThreadWordCache()
+	{
+		static thread_local HotWordCache cache;
+		return cache;
+	}
+
+	/**
+	 * Get the calling thread's words waiting to be added to the shared counts together
+	 */
+	static WordAccumulator::Batch& ThreadWordBatch()
+	{
+		static thread_local WordAccumulator::Batch batch;
+		return batch;
+	}
+
+	/**
+	 * Get the calling thread's batches of words for the aggregator threads
+	 */
+	static PartitionedWordCounter::Writer& ThreadPartitionWriter()
+	{
+		static thread_local PartitionedWordCounter::Writer writer;
+		return writer;
+	}
+
+	/**
+	 * Get the calling thread's word counts by ID
+	 */
+	static DictionaryWordCounter::Writer& ThreadDictionaryWriter()
+	{
+		static thread_local DictionaryWordCounter::Writer writer;
+		return writer;
+	}
+
+	/**
+	 * Get the calling thread's NUMA node, -1 if it hasn't joined one
+	 */
+	static int& ThreadNode()
+	{
+		static thread_local int node = -1;
+		return node;
+	}
+
+	/**
+	 * Get the word counts the calling thread adds words to outside of whole-file commits
+	 */
+	WordAccumulator& ThreadWords()
+	{
+		int node = ThreadNode();
+		return (Numa() && node >= 0 ? *mNodeWords[node] : mWordsFound);
+	}
+
+	/**
+	 * Check if processing threads count words per NUMA node
+	 */
+	bool Numa() const
+	{
+		return !mNumaNodes.empty();
+	}
+
+	/**
+	 * Pin the calling thread to a NUMA node's CPUs and make it count in that node's word counts, creating them if it is
+	 * the first thread on the node
+	 *
+	 * @param node	The node
+	 */
+	void JoinNode(const size_t &node)
+	{
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		for (int cpu : mNumaNodes[node])
+			CPU_SET(cpu, &cpus);
+		int err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+		if (err != 0)
+			cout << "Failed to pin a thread to NUMA node " << node << ": [" << err << "] " << strerror(err) << endl;
+
+		boost::mutex::scoped_lock lock(mNodeWordsMutex);
+		if (!mNodeWords[node])
+			mNodeWords[node].reset(new WordAccumulator(mSettings.wordStore, mSettings.vocabulary, mSettings.hugePages));
+		ThreadNode() = static_cast<int>(node);
+	}
+
+	/**
+	 * Add each NUMA node's word counts to mWordsFound and free them
+	 */
+	void MergeNodeWords()
+	{
+		for (auto &nodeWords : mNodeWords)
+		{
+			if (!nodeWords)
+				continue;
+			for (const auto &word : nodeWords->ListAllWords())
+				mWordsFound.AddWord(word.first, word.second);
+			nodeWords.reset();
+		}
+	}
+
+	/**
+	 * Check if words are counted by aggregator threads rather than in the shared counts
+	 */
+	bool Partitioned() const
+	{
+		return mSettings.aggregatorThreads > 0;
+	}
+
+	/**
+	 * Apply the configured I/O scheduling class to the calling thread
+	 */
+	void SetIoPriority() const
+	{
+		if (mSettings.ioPriorityClass == IOPRIO_CLASS_NONE)
+			return;
+
+		int level = (mSettings.ioPriorityClass == IOPRIO_CLASS_BE ? mSettings.ioPriorityLevel : 0);
+		if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, IOPRIO_PRIO_VALUE(mSettings.ioPriorityClass, level)) != 0)
+		{
+			int err = errno;
+			cout << "Failed to set I/O priority: [" << err << "] " << strerror(err) << endl;
+		}
+	}
+
 	/**
 	 * Parse and count the words in a file
 	 * 
 	 * @param filename	The full path/name of the file to process
+	 * @param sequence	The position of the file in the readahead window, 0 if it isn't in the window
 	 */
-	void ProcessFile(const string& filename)
+	template<typename Policy>
+	void ProcessFile(const string& filename, const uint64_t& sequence)
 	{
-		ifstream textFile(filename);
-		if (!textFile.good())
+		// Files still queued when a budget runs out are dropped; with checkpoints they stay pending for a resume
+		if (Cancelled())
+			return;
+		if (mSettings.readaheadDepth > 0 && sequence > 0)
+			mReadahead.FileStarted(sequence);
+		mFileLimiter.Acquire(1);
+		static thread_local CpuDutyCycle dutyCycle(mSettings.cpuDutyPercent);
+
+		// With checkpoints or sampling, a file's words are held back until the whole file has been read
+		unordered_map<string, int> fileWords;
+		bool holdBack = (Checkpointing() || Sampling());
+		const StopWords* stopWords = mSettings.stopWords;
+		HotWordCache* wordCache = (mUseWordCache ? &ThreadWordCache() : NULL);
+		WordAccumulator::Batch& wordBatch = ThreadWordBatch();
+		WordAccumulator& words = ThreadWords();
+		PartitionedWordCounter::Writer* partitionWriter = (Partitioned() ? &ThreadPartitionWriter() : NULL);
+		DictionaryWordCounter::Writer* dictionaryWriter = (mSettings.dictionary ? &ThreadDictionaryWriter() : NULL);
+		auto addWord = [&](const string& word)
 		{
-			int err = errno;
+			if (stopWords != NULL && stopWords->Contains(word))
+				return;
+			if (holdBack)
+				fileWords[word]++;
+			else if (partitionWriter != NULL)
+				partitionWriter->AddWord(word, mPartitionedWords);
+			else if (dictionaryWriter != NULL)
+				dictionaryWriter->AddWord(word, mDictionaryWords);
+			else if (wordCache != NULL)
+				wordCache->AddWord(word, words, wordBatch);
+			else
+				wordBatch.AddWord(word, words);
+		};
+
+		FileReader textFile(filename, mReaderSettings);
+		if (!textFile.Open())
+		{
+			int err = textFile.GetError();
 			string message(strerror(err));
 			cout << "Failed to open '" << filename << "': [" << err << "] " << message << endl;
+			CommitFile(filename, fileWords, false, 0, 0);
 			return;
 		}
 
-		size_t buffSize = 2048; // 2k seems like more than enough characters for a single word; assert below catches possible overflow
-		char* wordBuffer = new char[buffSize];
-		size_t bufIndex = 0;
-		string word;
-		while(true)
+		Tokenizer<Policy> tokenizer(mSettings.tokenFilter);
+		const char* block;
+		size_t blockLength;
+		bool afterHole;
+		uint64_t bytesRead = 0;
+		bool abandoned = false;
+		while (true)
 		{
-			char ch = textFile.get();
-			if (!textFile.good())
-				break;
-
-			// Is this an aphanumeric character
-			int ascii = (int)ch;
-			bool alphanum = false;
-			if ( (ascii >= 48 && ascii <= 57) ||	// numeric
-				 (ascii >= 97 && ascii <= 122) )	// lowercase
+			if (Cancelled())
 			{
-				alphanum = true;
-			}
-			else if (ascii >= 65 && ascii <= 90)	// uppercase
-			{
-				alphanum = true;
-				ch = (char)(ascii + 32); // lowercase the character
+				abandoned = true;
+				break;
 			}
+			if (!textFile.Next(block, blockLength, afterHole))
+				break;
+			mByteLimiter.Acquire(blockLength);
+			dutyCycle.Check();
+			bytesRead += blockLength;
+			mBudgetBytes += blockLength;
+
+			// A hole in a sparse file reads as zeros, so it ends the current word like any other separator
+			if (afterHole)
+				tokenizer.EndWord(addWord);
+			tokenizer.Add(block, blockLength, addWord);
+		}
+		if (!abandoned)
+			tokenizer.Finish(addWord);
+		if (textFile.GetError() != 0)
+		{
+			int err = textFile.GetError();
+			cout << "Failed reading file '" << filename << "': [" << err << "] " << strerror(err) << endl;
+		}
+		textFile.Close();
 
-			// If the character is alphanumeric, add it to the buffer
-			if (alphanum)
+		// Without checkpoints the words from the part that was read have already been counted, so the partial file is
+		// reported as such.  With checkpoints they are thrown away and the file stays pending, to be read in full on
+		// resume.  A partial file would skew a sample, so it is thrown away when sampling too
+		if (abandoned && holdBack)
+			return;
+		CommitFile(filename, fileWords, true, bytesRead, textFile.GetSkippedBytes());
+	}
+
+	/**
+	 * Record that a file is done: add its held back words and its statistics, and move it from pending to completed
+	 * 
+	 * @param filename		The full path/name of the file
+	 * @param fileWords		The words counted in the file when checkpointing or sampling
+	 * @param processed		False if the file could not be opened
+	 * @param bytesRead		The number of bytes read from the file
+	 * @param bytesSkipped	The number of bytes of holes skipped in the file
+	 */
+	void CommitFile(const string& filename, const unordered_map<string, int>& fileWords, const bool& processed,
+					const uint64_t& bytesRead, const uint64_t& bytesSkipped)
+	{
+		if (Sampling() && processed && mEstimator.AddFile(fileWords))
+			Stop(StopReason::Converged);
+
+		if (!Checkpointing())
+		{
+			// Only the estimator's counts are reported when sampling, so there is no need to keep the words twice
+			if (!Sampling())
 			{
-				wordBuffer[bufIndex] = ch;
-				bufIndex++;
-				assert(bufIndex < buffSize); // Catch possible buffer overflow
+				for (const auto& word : fileWords)
+					mWordsFound.AddWord(word.first, word.second);
 			}
-			// If it isn't alphanumeric and there is something in the buffer, this is the end of the previous word
-			else if (bufIndex > 0)
+			mStats.filesProcessed += (processed ? 1 : 0);
+			mStats.bytesRead += bytesRead;
+			mStats.bytesSkipped += bytesSkipped;
+			return;
+		}
+
+		boost::shared_lock<boost::shared_mutex> commitLock(mCommitMutex);
+		for (const auto& word : fileWords)
+			mWordsFound.AddWord(word.first, word.second);
+		mStats.filesProcessed += (processed ? 1 : 0);
+		mStats.bytesRead += bytesRead;
+		mStats.bytesSkipped += bytesSkipped;
+
+		// A file that could not be opened is completed too; retrying it on resume would most likely fail the same way
+		boost::mutex::scoped_lock filesLock(mFilesMutex);
+		mPendingFiles.erase(filename);
+		mCompletedFiles.insert(filename);
+	}
+
+	/**
+	 * Check if the run is stopping early, stopping it if a time or byte budget has run out.  Cheap enough to call once
+	 * per block
+	 * 
+	 * @return	True if the search and the processing threads should stop
+	 */
+	bool Cancelled()
+	{
+		if (mStopReason.load(memory_order_relaxed) != StopReason::None)
+			return true;
+		if (mSettings.byteBudget > 0 && mBudgetBytes >= mSettings.byteBudget)
+			return Stop(StopReason::ByteBudget);
+		if (mSettings.timeBudget > 0 && chrono::steady_clock::now() >= mDeadline)
+			return Stop(StopReason::TimeBudget);
+		return false;
+	}
+
+	/**
+	 * Stop the run early.  The first reason given is the one that sticks
+	 * 
+	 * @param reason	Why the run is stopping
+	 * @return			True
+	 */
+	bool Stop(const StopReason& reason)
+	{
+		StopReason none = StopReason::None;
+		mStopReason.compare_exchange_strong(none, reason);
+		return true;
+	}
+
+	/**
+	 * Check if a sample of the files is being processed instead of all of them
+	 */
+	bool Sampling() const
+	{
+		return (mSettings.sampleFiles > 0);
+	}
+
+	/**
+	 * Check if progress is being saved to a checkpoint
+	 */
+	bool Checkpointing() const
+	{
+		return !mSettings.checkpointPath.empty();
+	}
+
+	/**
+	 * Body of the checkpoint thread; saves a checkpoint every checkpointInterval seconds until the run is finished
+	 */
+	void CheckpointThread()
+	{
+		boost::unique_lock<boost::mutex> lock(mCheckpointMutex);
+		while (!mStopCheckpoints)
+		{
+			if (mCheckpointCondition.wait_for(lock, boost::chrono::seconds(mSettings.checkpointInterval)) == boost::cv_status::timeout)
 			{
-				wordBuffer[bufIndex] = '\0';
-				// Convert to string
-				word.assign(wordBuffer);
-				mWordsFound.AddWord(word);
-				bufIndex = 0;
+				lock.unlock();
+				SaveCheckpoint();
+				lock.lock();
 			}
 		}
-		if (!textFile.eof())
+	}
+
+	/**
+	 * Take a consistent snapshot of the progress so far and save it.  Only the copy is made with the processing threads
+	 * held off; the write happens after they have been let go
+	 */
+	void SaveCheckpoint()
+	{
+		Checkpoint checkpoint;
+		{
+			boost::unique_lock<boost::shared_mutex> commitLock(mCommitMutex);
+			checkpoint.options = mSettings.countingOptions;
+			checkpoint.words = mWordsFound.ListAllWords();
+			checkpoint.filesProcessed = mStats.filesProcessed;
+			checkpoint.bytesRead = mStats.bytesRead;
+			checkpoint.bytesSkipped = mStats.bytesSkipped;
+
+			boost::mutex::scoped_lock filesLock(mFilesMutex);
+			checkpoint.searchComplete = mSearchComplete;
+			checkpoint.completedFiles.assign(mCompletedFiles.begin(), mCompletedFiles.end());
+			checkpoint.pendingFiles.assign(mPendingFiles.begin(), mPendingFiles.end());
+		}
+
+		if (!checkpoint.Save(mSettings.checkpointPath))
 		{
 			int err = errno;
-			cout << "Failed reading file '" << filename << "': [" << err << "] " << strerror(err) << endl;
+			cout << "Failed to save checkpoint '" << mSettings.checkpointPath << "': [" << err << "] " << strerror(err) << endl;
 		}
-		delete wordBuffer;
-		textFile.close();
 	}
 
 	/**
-	 * Recursively search for text files under a given path, post found files to threadpool for processing
+	 * Load the checkpoint and pick up where it left off
 	 * 
-	 * @param basePath	The path to search
+	 * @param pendingFiles		Set to the files left to process, if the checkpointed run had finished searching
+	 * @param searchComplete	Set to true if the checkpointed run had finished searching, false if the search needs to be
+	 * 							run again; files completed before the checkpoint are skipped either way
+	 * @return					False if the checkpoint was made with different counting options and can't be resumed
 	 */
-	void SearchForFiles(const string& basePath)
+	bool RestoreCheckpoint(vector<string>& pendingFiles, bool& searchComplete)
 	{
-		DIR* dir = opendir(basePath.c_str());
-		if (dir == NULL)
+		searchComplete = false;
+		Checkpoint checkpoint;
+		if (!checkpoint.Load(mSettings.checkpointPath))
+		{
+			cout << "No usable checkpoint in '" << mSettings.checkpointPath << "', starting from the beginning" << endl;
+			return true;
+		}
+
+		// Counts made under different rules can't be added together
+		if (checkpoint.options != mSettings.countingOptions)
+		{
+			cout << "The checkpoint in '" << mSettings.checkpointPath << "' was made with a different path or different "
+				 << "word options; resume with the same ones it was made with, or start over without --resume" << endl;
+			return false;
+		}
+
+		for (const auto& word : checkpoint.words)
+			mWordsFound.AddWord(word.first, word.second);
+		mStats.filesProcessed = checkpoint.filesProcessed;
+		mStats.bytesRead = checkpoint.bytesRead;
+		mStats.bytesSkipped = checkpoint.bytesSkipped;
+		mStats.bytesFound = checkpoint.bytesRead + checkpoint.bytesSkipped;	// Completed files were read in full
+		mCompletedFiles.insert(checkpoint.completedFiles.begin(), checkpoint.completedFiles.end());
+		pendingFiles.swap(checkpoint.pendingFiles);
+		searchComplete = checkpoint.searchComplete;
+		return true;
+	}
+
+	/**
+	 * Queue a found file for processing, either right away or as part of a sorted batch
+	 * 
+	 * @param file	The file to queue
+	 */
+	void DispatchFile(const FileEntry& file)
+	{
+		if (Checkpointing())
 		{
-			cout << strerror(errno) << endl;
+			// Skip files a resumed run has already done, and remember the rest until they are done
+			boost::mutex::scoped_lock lock(mFilesMutex);
+			if (mCompletedFiles.count(file.path) > 0 || !mPendingFiles.insert(file.path).second)
+				return;
+		}
+		mStats.bytesFound += file.size;
+
+		if (Sampling())
+		{
+			mSampler.AddFile(file);
 			return;
 		}
 
-		struct dirent *entry;
-		string entryPath;
-		while ((entry = readdir(dir)) != NULL)
+		if (mSettings.order == FileOrder::Readdir)
 		{
-			if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
-				continue;
+			PostFile(file);
+			return;
+		}
 
-			// Make an absolute path
-			entryPath.assign(basePath + "/" + entry->d_name);
+		if (mOrderer.AddFile(file))
+			PostFiles(mOrderer.TakeBatch());
+	}
 
-			// Make sure the file exists and is readable
-			struct stat entryStat;
-			if(lstat(entryPath.c_str(), &entryStat) != 0)
-			{
-				continue;
-			}
+	/**
+	 * Post a batch of files to the threadpool for processing, in order
+	 * 
+	 * @param files	The files to post
+	 */
+	void PostFiles(const vector<FileEntry>& files)
+	{
+		for (const auto& file : files)
+			PostFile(file);
+	}
 
-			// This implementation ignores symlinks.  It's not clear from the requirements if following symlinks is required,
-			// so I am leaving that functionality out so as to not have to deal with all of the ways symlinks can be broken,
-			// links to links, circular links, and any other link madness that is possible in Linux.
-			// This means that the results of this searcher are the same as the command 'find <basePath> -type f -name "*.txt"'
-			if (S_ISLNK(entryStat.st_mode))
-			{
-				continue;
-			}
+	/**
+	 * Post a file to the threadpool for processing
+	 * 
+	 * @param file	The file to post
+	 */
+	void PostFile(const FileEntry& file)
+	{
+		// Cached files don't need readahead or an I/O thread
+		if (mSettings.ioThreads > 0 && mCacheProbe.IsCached(file.path))
+		{
+			mIOService.post(boost::bind(mProcessFile, this, file.path, 0));
+			return;
+		}
 
-			if (S_ISREG(entryStat.st_mode))
-			{
-				// Test if the filename ends in ".txt"
-				int len = strlen(entry->d_name);
-				if (len >= 4 && strcmp(&entry->d_name[len-4], ".txt") == 0)
-				{
-					mIOService.post(boost::bind(&FileIndexer::ProcessFile, this, entryPath));
-				}
-			}
-			else if (S_ISDIR(entryStat.st_mode))
+		uint64_t sequence = 0;
+		if (mSettings.readaheadDepth > 0)
+			sequence = mReadahead.AddFile(file.path);
+		boost::asio::io_service& service = (mSettings.ioThreads > 0 ? mColdIOService : mIOService);
+		service.post(boost::bind(mProcessFile, this, file.path, sequence));
+	}
+
+	/**
+	 * Queue a file known only by its path, if it is a regular file like the search would accept
+	 * 
+	 * @param path	The path of the file
+	 */
+	void DispatchPath(const string& path)
+	{
+		struct stat fileStat;
+		if (lstat(path.c_str(), &fileStat) != 0 || !S_ISREG(fileStat.st_mode))
+			return;
+		DispatchFile(FileEntry(path, fileStat.st_ino, fileStat.st_size));
+	}
+
+	/**
+	 * Read the files to process from a list instead of searching for them, posting each one as soon as it is read
+	 * 
+	 * @param listPath	The file containing the list, or "-" for stdin
+	 */
+	void ReadFileList(const string& listPath)
+	{
+		FileListReader list(listPath, mSettings.fileListDelimiter);
+		if (!list.Open())
+		{
+			int err = list.GetError();
+			cout << "Failed to open '" << listPath << "': [" << err << "] " << strerror(err) << endl;
+			return;
+		}
+
+		// The list is taken as given, without the ".txt" filter
+		string path;
+		while (!Cancelled() && list.Next(path))
+			DispatchPath(path);
+		if (list.GetError() != 0)
+		{
+			int err = list.GetError();
+			cout << "Failed reading '" << listPath << "': [" << err << "] " << strerror(err) << endl;
+		}
+	}
+
+	/**
+	 * Search for text files under a given path, post found files to threadpool for processing
+	 * 
+	 * @param basePath	The path to search
+	 */
+	void SearchForFiles(const string& basePath)
+	{
+		// Reuse the listings of unchanged directories from the last run's snapshot, if there is one
+		TraversalCache cache;
+		bool useCache = !mSettings.traversalCachePath.empty();
+		if (useCache)
+			cache.Load(mSettings.traversalCachePath);
+
+		DirectoryWalker walker(mSettings.traversalOrder, mSettings.maxOpenDirectories, useCache ? &cache : NULL);
+		bool finished = walker.Walk(basePath, [this](const FileEntry& file)
+		{
+			// Test if the filename ends in ".txt"
+			if (file.path.size() >= 4 && file.path.compare(file.path.size() - 4, 4, ".txt") == 0)
 			{
-				SearchForFiles(entryPath);
+				DispatchFile(file);
 			}
+			return !Cancelled();
+		});
+
+		// A walk cut short has only part of some directories' listings, which must not be reused
+		if (useCache && finished && !cache.Save(mSettings.traversalCachePath))
+		{
+			int err = errno;
+			cout << "Failed to save traversal cache '" << mSettings.traversalCachePath << "': [" << err << "] " << strerror(err) << endl;
 		}
-		closedir(dir);
 	}
 
 };
 
+/**
+ * Describe the options that decide which files are read and which words are counted, so a resumed run can check it is
+ * counting the same way as the run that saved the checkpoint
+ *
+ * @param options	The parsed command line
+ * @return			One name=value line per option
+ */
+static string DescribeCountingOptions(const ProgramOptions& options)
+{
+	string description;
+	for (const char* name : { "path", "files-from", "tokenizer", "stop-words", "long-words", "vocabulary" })
+		description += string(name) + "=" + (options.HasOption(name) ? options.GetOptionValue<string>(name) : "") + "\n";
+	for (const char* name : { "min-word-length", "max-word-length" })
+		description += string(name) + "=" + to_string(options.GetOptionValue<int>(name)) + "\n";
+	for (const char* name : { "null", "skip-numbers", "skip-hex" })
+		description += string(name) + "=" + (options.GetOptionValue<bool>(name) ? "1" : "0") + "\n";
+	description += "max-digit-ratio=" + to_string(options.GetOptionValue<double>("max-digit-ratio")) + "\n";
+	return description;
+}
 
 int main(int argc, char** argv)
 {
@@ -229,23 +992,154 @@ int main(int argc, char** argv)
 		return 0;
 	}
 
-	string searchPath = options.GetOptionValue<string>("path");
-	int threadCount = options.GetOptionValue<int>("threads");
+	FileIndexerSettings settings;
+	string searchPath;
+	if (options.HasOption("files-from"))
+	{
+		settings.fileListPath = options.GetOptionValue<string>("files-from");
+		if (options.GetOptionValue<bool>("null"))
+			settings.fileListDelimiter = '\0';
+	}
+	else
+	{
+		searchPath = options.GetOptionValue<string>("path");
 
-	// Check that the specified path exists
-	DIR *dir = opendir(searchPath.c_str());
-	if (dir == NULL)
+		// Check that the specified path exists
+		DIR *dir = opendir(searchPath.c_str());
+		if (dir == NULL)
+		{
+			cout << "The specified path does not exist: " << searchPath << endl;
+			return 1;
+		}
+		closedir(dir);
+	}
+
+	settings.fileProcessingThreads = options.GetOptionValue<int>("threads");
+	string order = options.GetOptionValue<string>("order");
+	if (order == "inode")
+		settings.order = FileOrder::Inode;
+	else if (order == "extent")
+		settings.order = FileOrder::Extent;
+	settings.orderBatchSize = options.GetOptionValue<int>("order-batch");
+	settings.readaheadDepth = options.GetOptionValue<int>("readahead");
+	settings.dropCache = options.GetOptionValue<bool>("drop-cache");
+	settings.ioThreads = options.GetOptionValue<int>("io-threads");
+	settings.directIO = options.GetOptionValue<bool>("direct-io");
+	settings.directQueueDepth = options.GetOptionValue<int>("direct-queue-depth");
+	settings.maxBytesPerSecond = options.GetOptionValue<double>("max-mbps") * 1024 * 1024;
+	settings.maxFilesPerSecond = options.GetOptionValue<double>("max-files-per-sec");
+	string ioClass = options.GetOptionValue<string>("io-class");
+	if (ioClass == "best-effort")
+		settings.ioPriorityClass = IOPRIO_CLASS_BE;
+	else if (ioClass == "idle")
+		settings.ioPriorityClass = IOPRIO_CLASS_IDLE;
+	settings.ioPriorityLevel = options.GetOptionValue<int>("io-level");
+	settings.cpuDutyPercent = options.GetOptionValue<int>("cpu-duty");
+	if (options.GetOptionValue<string>("traversal") == "bfs")
+		settings.traversalOrder = TraversalOrder::BreadthFirst;
+	settings.maxOpenDirectories = options.GetOptionValue<int>("max-open-dirs");
+	if (options.HasOption("traversal-cache"))
+		settings.traversalCachePath = options.GetOptionValue<string>("traversal-cache");
+	if (options.HasOption("checkpoint"))
+		settings.checkpointPath = options.GetOptionValue<string>("checkpoint");
+	settings.checkpointInterval = options.GetOptionValue<int>("checkpoint-interval");
+	settings.resume = options.GetOptionValue<bool>("resume");
+	settings.countingOptions = DescribeCountingOptions(options);
+	settings.timeBudget = options.GetOptionValue<double>("time-budget");
+	settings.byteBudget = options.GetOptionValue<double>("byte-budget") * 1024 * 1024;
+	settings.sampleFiles = options.GetOptionValue<int>("sample");
+	settings.sampleTolerance = options.GetOptionValue<double>("sample-tolerance");
+	settings.aggregatorThreads = options.GetOptionValue<int>("aggregators");
+	if (options.GetOptionValue<string>("word-store") == "lock-free")
+		settings.wordStore = WordStore::LockFree;
+	settings.dictionary = options.GetOptionValue<bool>("dictionary");
+	string hugePages = options.GetOptionValue<string>("huge-pages");
+	if (hugePages == "transparent")
+		settings.hugePages = HugePageMode::Transparent;
+	else if (hugePages == "explicit")
+		settings.hugePages = HugePageMode::Explicit;
+	settings.numa = options.GetOptionValue<bool>("numa");
+	string tokenizer = options.GetOptionValue<string>("tokenizer");
+	if (tokenizer == "ascii")
+		settings.wordRules = WordRules::Ascii;
+	else if (tokenizer == "code")
+		settings.wordRules = WordRules::Code;
+	else if (tokenizer == "hyphen")
+		settings.wordRules = WordRules::Hyphenated;
+	else if (tokenizer == "case-sensitive")
+		settings.wordRules = WordRules::CaseSensitive;
+	settings.tokenFilter.minLength = options.GetOptionValue<int>("min-word-length");
+	settings.tokenFilter.maxLength = options.GetOptionValue<int>("max-word-length");
+	if (options.GetOptionValue<string>("long-words") == "skip")
+		settings.tokenFilter.longWords = LongWordAction::Skip;
+	settings.tokenFilter.skipNumbers = options.GetOptionValue<bool>("skip-numbers");
+	settings.tokenFilter.skipHex = options.GetOptionValue<bool>("skip-hex");
+	settings.tokenFilter.maxDigitRatio = options.GetOptionValue<double>("max-digit-ratio");
+	StopWords stopWords;
+	if (options.HasOption("stop-words"))
 	{
-		cout << "The specified path does not exist: " << searchPath << endl;
-        return 1;
+		string stopWordsPath = options.GetOptionValue<string>("stop-words");
+		WordListStatus status = WordListStatus::Loaded;
+		if (stopWordsPath == "english")
+			stopWords.UseBuiltIn();
+		else
+			status = stopWords.Load(stopWordsPath);
+		if (status == WordListStatus::Unreadable)
+		{
+			int err = errno;
+			cout << "Failed to read stop words '" << stopWordsPath << "': [" << err << "] " << strerror(err) << endl;
+			return 1;
+		}
+		if (status == WordListStatus::Unhashable)
+		{
+			cout << "Failed to index stop words '" << stopWordsPath << "': two of the words have the same hash" << endl;
+			return 1;
+		}
+		if (!stopWords.Empty())
+			settings.stopWords = &stopWords;
+	}
+	Vocabulary vocabulary;
+	if (options.HasOption("vocabulary"))
+	{
+		string vocabularyPath = options.GetOptionValue<string>("vocabulary");
+		WordListStatus status = vocabulary.Load(vocabularyPath);
+		if (status == WordListStatus::Unreadable)
+		{
+			int err = errno;
+			cout << "Failed to read vocabulary '" << vocabularyPath << "': [" << err << "] " << strerror(err) << endl;
+			return 1;
+		}
+		if (status == WordListStatus::Unhashable)
+		{
+			cout << "Failed to index vocabulary '" << vocabularyPath << "': two of the words have the same hash" << endl;
+			return 1;
+		}
+		if (vocabulary.Size() > 0)
+			settings.vocabulary = &vocabulary;
 	}
-	closedir(dir);
 
 	// Create the indexer and run it
-	FileIndexer ssfi(searchPath, threadCount);
-	ssfi.Run();
+	FileIndexer ssfi(searchPath, settings);
+	if (!ssfi.Run())
+		return 1;
 
 	// Show the top 10 words	
+	if (settings.sampleFiles > 0)
+	{
+		// Extrapolated counts with their 95% confidence intervals
+		bool anyUncertain = false;
+		vector<WordEstimate> topEstimates = ssfi.ListTopEstimates();
+		for (const auto& estimate : topEstimates)
+		{
+			cout << estimate.word << "\t" << llround(estimate.count) << "\t+/- " << llround(estimate.margin)
+				 << (estimate.certain ? "" : "\t*") << endl;
+			anyUncertain = anyUncertain || !estimate.certain;
+		}
+		if (anyUncertain)
+			cout << "* may not be in the top " << settings.sampleTopWords << endl;
+		return 0;
+	}
+
 	vector<WordCountType> topWords = ssfi.ListTopWords(10);
 	for (const auto& word : topWords)
 	{
@@ -0,0 +1,116 @@
+#include <boost/thread/thread.hpp>
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <stdlib.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "DictionaryWordCounter.h"
+using namespace std;
+
+/**
+ * Stress test for DictionaryWordCounter: several threads number and count a Zipf-distributed stream of words at once, so
+ * the same new words are looked up by every thread at the same time while the long tail keeps growing the dictionary's
+ * tables under readers that don't lock.  The results must match counts taken on a single thread, with every word given
+ * exactly one ID.
+ *
+ * Usage: DictionaryWordCounterStress [threads] [words] [vocabulary]
+ */
+
+/**
+ * Make a stream of words whose frequencies follow Zipf's law, the way words in text do.  Some words are longer than
+ * others so both short and long words are compared
+ */
+static vector<string> MakeZipfStream(const size_t &length, const size_t &vocabularySize, const unsigned &seed)
+{
+	vector<string> vocabulary(vocabularySize);
+	vector<double> cumulative(vocabularySize);
+	double total = 0;
+	for (size_t rank = 0; rank < vocabularySize; ++rank)
+	{
+		vocabulary[rank] = "w" + to_string(rank) + (rank % 7 == 0 ? string(rank % 40, 'x') : string());
+		total += 1.0 / (rank + 1);
+		cumulative[rank] = total;
+	}
+
+	mt19937_64 random(seed);
+	uniform_real_distribution<double> uniform(0, total);
+	vector<string> stream(length);
+	for (auto &word : stream)
+	{
+		size_t rank = lower_bound(cumulative.begin(), cumulative.end(), uniform(random)) - cumulative.begin();
+		word = vocabulary[min(rank, vocabularySize - 1)];
+	}
+	return stream;
+}
+
+/**
+ * Count a stream from several threads at once, each with a Writer of its own
+ *
+ * @return	True if the counts and the number of unique words matched the single-threaded counts
+ */
+static bool RunRound(DictionaryWordCounter &counter, const vector<string> &stream, const unordered_map<string, int> &expected, const int &threads)
+{
+	vector<boost::thread> writers;
+	for (int t = 0; t < threads; ++t)
+	{
+		writers.emplace_back([&, t]()
+		{
+			DictionaryWordCounter::Writer writer;
+			for (size_t i = t; i < stream.size(); i += threads)
+				writer.AddWord(stream[i], counter);
+			writer.Flush(counter);
+		});
+	}
+	for (auto &writer : writers)
+		writer.join();
+
+	bool passed = true;
+	if (counter.GetUniqueWordCount() != expected.size())
+	{
+		cout << "Expected " << expected.size() << " unique words, got " << counter.GetUniqueWordCount() << endl;
+		passed = false;
+	}
+
+	vector<WordCountType> words = counter.ListTopWords(static_cast<int>(expected.size()));
+	if (words.size() != expected.size())
+	{
+		cout << "Expected " << expected.size() << " words listed, got " << words.size() << endl;
+		passed = false;
+	}
+	for (const auto &word : words)
+	{
+		auto found = expected.find(word.first);
+		if (found == expected.end() || found->second != word.second)
+		{
+			cout << "Wrong count for '" << word.first << "': expected " << (found == expected.end() ? 0 : found->second)
+				 << ", got " << word.second << endl;
+			passed = false;
+			break;
+		}
+	}
+	return passed;
+}
+
+int main(int argc, char** argv)
+{
+	int threads = (argc > 1 ? atoi(argv[1]) : 8);
+	size_t length = (argc > 2 ? strtoul(argv[2], NULL, 10) : 2000000);
+	size_t vocabularySize = (argc > 3 ? strtoul(argv[3], NULL, 10) : 300000);
+
+	vector<string> stream = MakeZipfStream(length, vocabularySize, 42);
+	unordered_map<string, int> expected;
+	for (const auto &word : stream)
+		expected[word]++;
+
+	// Again after ClearResults, which starts the dictionary over from the smallest tables
+	DictionaryWordCounter counter;
+	bool passed = RunRound(counter, stream, expected, threads);
+	counter.ClearResults();
+	passed = RunRound(counter, stream, expected, threads) && passed;
+
+	cout << "DictionaryWordCounter stress test " << (passed ? "passed" : "FAILED") << ": " << threads << " threads, "
+		 << length << " words, " << expected.size() << " unique" << endl;
+	return passed ? 0 : 1;
+}
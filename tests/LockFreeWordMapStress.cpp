@@ -0,0 +1,144 @@
+#include <boost/thread/thread.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <stdlib.h>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "LockFreeWordMap.h"
+using namespace std;
+
+/**
+ * Stress test for LockFreeWordMap: several threads add a Zipf-distributed stream of words at once, so a handful of hot
+ * words are counted by every thread at the same time while the long tail keeps adding new words and growing the map
+ * through many resizes.  The results must match counts taken on a single thread.
+ *
+ * Usage: LockFreeWordMapStress [threads] [words] [vocabulary]
+ */
+
+/**
+ * Make a stream of words whose frequencies follow Zipf's law, the way words in text do.  Some words are longer than
+ * others so both short and long keys are compared
+ */
+static vector<string> MakeZipfStream(const size_t &length, const size_t &vocabularySize, const unsigned &seed)
+{
+	vector<string> vocabulary(vocabularySize);
+	vector<double> cumulative(vocabularySize);
+	double total = 0;
+	for (size_t rank = 0; rank < vocabularySize; ++rank)
+	{
+		vocabulary[rank] = "w" + to_string(rank) + (rank % 7 == 0 ? string(rank % 40, 'x') : string());
+		total += 1.0 / (rank + 1);
+		cumulative[rank] = total;
+	}
+
+	mt19937_64 random(seed);
+	uniform_real_distribution<double> uniform(0, total);
+	vector<string> stream(length);
+	for (auto &word : stream)
+	{
+		size_t rank = lower_bound(cumulative.begin(), cumulative.end(), uniform(random)) - cumulative.begin();
+		word = vocabulary[min(rank, vocabularySize - 1)];
+	}
+	return stream;
+}
+
+/**
+ * Add a stream to a map from several threads at once, with another thread listing the words as they are added
+ *
+ * @return	True if every count listed along the way and at the end matched the single-threaded counts
+ */
+static bool RunRound(LockFreeWordMap &map, const vector<string> &stream, const unordered_map<string, int> &expected, const int &threads)
+{
+	hash<string> hasher;
+	atomic<bool> adding(true);
+	atomic<bool> listedTooMany(false);
+
+	// Counts only go up, so a listing taken part way through can never be past the final counts
+	boost::thread lister([&]()
+	{
+		while (adding.load())
+		{
+			for (const auto &word : map.ListAllWords())
+			{
+				auto found = expected.find(word.first);
+				if (found == expected.end() || word.second > found->second)
+					listedTooMany.store(true);
+			}
+		}
+	});
+
+	vector<boost::thread> adders;
+	for (int t = 0; t < threads; ++t)
+	{
+		adders.emplace_back([&, t]()
+		{
+			for (size_t i = t; i < stream.size(); i += threads)
+				map.AddWord(stream[i], 1, hasher(stream[i]));
+		});
+	}
+	for (auto &adder : adders)
+		adder.join();
+	adding.store(false);
+	lister.join();
+
+	bool passed = true;
+	if (listedTooMany.load())
+	{
+		cout << "A listing during the adds had a word that wasn't added or a count past its final count" << endl;
+		passed = false;
+	}
+	if (map.GetUniqueWordCount() != expected.size())
+	{
+		cout << "Expected " << expected.size() << " unique words, got " << map.GetUniqueWordCount() << endl;
+		passed = false;
+	}
+
+	vector<pair<string, int> > words = map.ListAllWords();
+	if (words.size() != expected.size())
+	{
+		cout << "Expected " << expected.size() << " words listed, got " << words.size() << endl;
+		passed = false;
+	}
+	for (const auto &word : words)
+	{
+		auto found = expected.find(word.first);
+		if (found == expected.end() || found->second != word.second)
+		{
+			cout << "Wrong count for '" << word.first << "': expected " << (found == expected.end() ? 0 : found->second)
+				 << ", got " << word.second << endl;
+			passed = false;
+			break;
+		}
+	}
+	return passed;
+}
+
+int main(int argc, char** argv)
+{
+	int threads = (argc > 1 ? atoi(argv[1]) : 8);
+	size_t length = (argc > 2 ? strtoul(argv[2], NULL, 10) : 2000000);
+	size_t vocabularySize = (argc > 3 ? strtoul(argv[3], NULL, 10) : 300000);
+
+	vector<string> stream = MakeZipfStream(length, vocabularySize, 42);
+	unordered_map<string, int> expected;
+	for (const auto &word : stream)
+		expected[word]++;
+
+	// Again after Clear, which starts over from the smallest table, and once more with the tables on huge pages
+	LockFreeWordMap map;
+	bool passed = RunRound(map, stream, expected, threads);
+	map.Clear();
+	passed = RunRound(map, stream, expected, threads) && passed;
+	LockFreeWordMap hugePageMap(HugePageMode::Transparent);
+	passed = RunRound(hugePageMap, stream, expected, threads) && passed;
+
+	cout << "LockFreeWordMap stress test " << (passed ? "passed" : "FAILED") << ": " << threads << " threads, " << length
+		 << " words, " << expected.size() << " unique" << endl;
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,66 @@
+#include <iostream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "PerfectHash.h"
+#include "Vocabulary.h"
+using namespace std;
+
+/**
+ * Test that PerfectHash::Build gives up on words that share a hash instead of searching for a displacement forever, and
+ * still builds a working hash when the hashes are distinct.  A Vocabulary built from such words has to report it, which
+ * is what makes --vocabulary exit with an error instead of hanging or counting nothing.
+ *
+ * Usage: PerfectHashCollision
+ */
+
+int main()
+{
+	bool passed = true;
+	vector<string> words;
+	vector<uint64_t> hashes;
+	for (uint64_t i = 0; i < 1000; ++i)
+	{
+		words.push_back("word" + to_string(i));
+		hashes.push_back(PerfectHashMix(i, 12345));
+	}
+
+	PerfectHash hash;
+	if (!hash.Build(words, hashes) || hash.Size() != words.size())
+	{
+		cout << "Failed to build a hash of distinct words" << endl;
+		passed = false;
+	}
+	for (size_t i = 0; i < words.size() && passed; ++i)
+	{
+		size_t slot = hash.Find(words[i], hashes[i]);
+		if (slot == PerfectHash::NOT_FOUND || hash.Word(slot) != words[i])
+		{
+			cout << "Word '" << words[i] << "' was not found" << endl;
+			passed = false;
+		}
+	}
+
+	// Two different words with the same hash can never be given slots of their own
+	hashes[500] = hashes[10];
+	if (hash.Build(words, hashes))
+	{
+		cout << "Built a hash of words that share a hash" << endl;
+		passed = false;
+	}
+	if (hash.Size() != 0 || hash.Find(words[10], hashes[10]) != PerfectHash::NOT_FOUND)
+	{
+		cout << "A failed build left words behind" << endl;
+		passed = false;
+	}
+
+	Vocabulary vocabulary;
+	if (vocabulary.Build(words, hashes) != WordListStatus::Unhashable || vocabulary.Size() != 0)
+	{
+		cout << "A vocabulary of words that share a hash didn't report it" << endl;
+		passed = false;
+	}
+
+	cout << "PerfectHash collision test " << (passed ? "passed" : "FAILED") << endl;
+	return passed ? 0 : 1;
+}
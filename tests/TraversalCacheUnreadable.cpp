@@ -0,0 +1,121 @@
+#include <fcntl.h>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+#include "DirectoryWalker.h"
+#include "TraversalCache.h"
+using namespace std;
+
+/**
+ * Test that a subdirectory which couldn't be opened during a cached walk is still found by later walks that reuse its
+ * parent's listing.  The parent's mtime doesn't change when the subdirectory becomes readable again, so the parent is
+ * reused and the subdirectory has to come from the snapshot.
+ *
+ * The subdirectory is made unreadable by lowering the open file limit so that only the starting directory and the
+ * parent can be opened, which works the same way when the test runs as root, where permissions would be ignored.
+ *
+ * Usage: TraversalCacheUnreadable
+ */
+
+static void MakeFile(const string &path)
+{
+	FILE *file = fopen(path.c_str(), "w");
+	if (file != NULL)
+	{
+		fputs("some words\n", file);
+		fclose(file);
+	}
+}
+
+/**
+ * Walk a tree, loading the snapshot from the previous walk if there is one and saving the new one
+ *
+ * @param basePath		The tree to walk
+ * @param cachePath		The snapshot file
+ * @param fileLimit		If not zero, the open file limit to walk under
+ * @return				The number of files found
+ */
+static size_t CachedWalk(const string &basePath, const string &cachePath, const rlim_t &fileLimit)
+{
+	TraversalCache cache;
+	cache.Load(cachePath);
+	DirectoryWalker walker(TraversalOrder::DepthFirst, 64, &cache);
+
+	struct rlimit oldLimit;
+	getrlimit(RLIMIT_NOFILE, &oldLimit);
+	if (fileLimit != 0)
+	{
+		struct rlimit limit = oldLimit;
+		limit.rlim_cur = fileLimit;
+		setrlimit(RLIMIT_NOFILE, &limit);
+	}
+
+	size_t found = 0;
+	bool complete = walker.Walk(basePath, [&](const FileEntry &) { found++; return true; });
+	setrlimit(RLIMIT_NOFILE, &oldLimit);
+
+	if (complete)
+		cache.Save(cachePath);
+	return found;
+}
+
+int main()
+{
+	char baseTemplate[] = "/tmp/TraversalCacheUnreadable.XXXXXX";
+	if (mkdtemp(baseTemplate) == NULL)
+	{
+		cout << "Failed to make a temporary directory" << endl;
+		return 1;
+	}
+	string basePath(baseTemplate);
+	string parentPath(basePath + "/p");
+	string lockedPath(parentPath + "/locked");
+	string cachePath(basePath + ".cache");
+	mkdir(parentPath.c_str(), 0755);
+	mkdir(lockedPath.c_str(), 0755);
+	MakeFile(parentPath + "/a.txt");
+	MakeFile(lockedPath + "/b.txt");
+
+	// Age the parent so its listing is trusted
+	struct timeval old[2];
+	old[0].tv_sec = old[1].tv_sec = time(NULL) - 3600;
+	old[0].tv_usec = old[1].tv_usec = 0;
+	utimes(parentPath.c_str(), old);
+
+	// The lowest free descriptor is the next one opened, so the limit leaves room for exactly the base and the parent
+	int lowest = open("/dev/null", O_RDONLY);
+	close(lowest);
+
+	bool passed = true;
+	size_t found = CachedWalk(basePath, cachePath, lowest + 2);
+	if (found != 1)
+	{
+		cout << "Expected 1 file with the subdirectory unreadable, got " << found << endl;
+		passed = false;
+	}
+	for (int run = 2; run <= 3; ++run)
+	{
+		found = CachedWalk(basePath, cachePath, 0);
+		if (found != 2)
+		{
+			cout << "Expected 2 files on cached walk " << run << ", got " << found << endl;
+			passed = false;
+		}
+	}
+
+	remove((lockedPath + "/b.txt").c_str());
+	remove((parentPath + "/a.txt").c_str());
+	rmdir(lockedPath.c_str());
+	rmdir(parentPath.c_str());
+	rmdir(basePath.c_str());
+	remove(cachePath.c_str());
+
+	cout << "TraversalCache unreadable subdirectory test " << (passed ? "passed" : "FAILED") << endl;
+	return passed ? 0 : 1;
+}